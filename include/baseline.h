@@ -0,0 +1,40 @@
+#ifndef baseline
+#define baseline
+
+#include <string>
+#include <vector>
+#include "engine.h"
+
+/**
+ * Game as the original loop of main() played it, on byte array
+ * field and tetromino strings. Kept to check optimized engine
+ * against, see findDivergence().
+ */
+struct ReferenceGame {
+    char field[fieldArea]; // 0: empty, 1-7: tetromino index + 1, 9: wall.
+    PieceQueue queue;
+    bool isGameOver;
+    int currentPiece;
+    int currentRotation;
+    int currentX;
+    int currentY;
+    int speed; // Ticks per forced move down.
+    int speedCounter;
+    int pieceCount;
+    int score;
+    int level;
+};
+
+// Results of findDivergence() other than tick where games differ.
+const int noDivergence = -1;
+const int knownSpawnDifference = -2; // Engine ended game on purpose.
+
+void initReferenceGame(ReferenceGame &game, uint64_t seed);
+bool doesPieceFit(const ReferenceGame &game, int tetrominoIndex, int r,
+                  int posX, int posY);
+void tickReferenceGame(ReferenceGame &game, int key);
+int findDivergence(uint64_t seed, const std::vector<int8_t> &keys,
+                   std::string &difference);
+void shrinkDivergence(uint64_t seed, std::vector<int8_t> &keys);
+
+#endif
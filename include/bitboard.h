@@ -0,0 +1,147 @@
+#ifndef bitboard
+#define bitboard
+
+#include <cstdint>
+#include "counters.h"
+#include "globals.h"
+
+// Occupancy of one field row, bit x is set if cell x is not empty.
+typedef uint16_t Row;
+
+// Occupancy of one field column, bit y is set if cell y is not empty.
+typedef uint32_t Column;
+
+const Row fullRow = (1 << fieldWidth) - 1;
+const Row wallRow = 1 | (1 << (fieldWidth - 1));
+
+// Pixel masks of every tetromino in every rotation, bit (4 * y + x)
+// is set if pixel is 'X'. Same as rotateAllTetrominoes() output.
+constexpr uint16_t pieceMasks[tetrominoCount][rotationCount] = {
+    {0x4444, 0x0F00, 0x2222, 0x00F0},
+    {0x0464, 0x0E40, 0x2620, 0x0270},
+    {0x0660, 0x0660, 0x0660, 0x0660},
+    {0x0264, 0x0C60, 0x2640, 0x0630},
+    {0x0462, 0x06C0, 0x4620, 0x0360},
+    {0x0622, 0x02E0, 0x4460, 0x0740},
+    {0x0644, 0x0E20, 0x2260, 0x0470},
+};
+
+// Lowest pixel row of every tetromino column in every rotation,
+// -1 for empty columns.
+constexpr int pieceBottoms[tetrominoCount][rotationCount][tetrominoWidth] = {
+    {{-1, -1, 3, -1}, {2, 2, 2, 2}, {-1, 3, -1, -1}, {1, 1, 1, 1}},
+    {{-1, 1, 2, -1}, {-1, 2, 2, 2}, {-1, 3, 2, -1}, {1, 2, 1, -1}},
+    {{-1, 2, 2, -1}, {-1, 2, 2, -1}, {-1, 2, 2, -1}, {-1, 2, 2, -1}},
+    {{-1, 2, 1, -1}, {-1, 1, 2, 2}, {-1, 3, 2, -1}, {1, 2, 2, -1}},
+    {{-1, 1, 2, -1}, {-1, 2, 2, 1}, {-1, 2, 3, -1}, {2, 2, 1, -1}},
+    {{-1, 2, 2, -1}, {-1, 2, 1, 1}, {-1, 1, 3, -1}, {2, 2, 2, -1}},
+    {{-1, 2, 2, -1}, {-1, 2, 2, 2}, {-1, 3, 1, -1}, {1, 1, 2, -1}},
+};
+
+/**
+ * Game field stored both as row and column bitmasks
+ * for collision and as cell values for rendering.
+ */
+struct Board {
+    Row rows[fieldHeight];
+    Column cols[fieldWidth];
+    char field[fieldArea]; // 0: empty, 1-7: tetromino index + 1, 9: wall.
+    int cells;             // Number of locked cells inside walls.
+};
+
+/**
+ * Getting one row of tetromino pixels shifted to field column.
+ *
+ * Pixels which fall out of the field are dropped.
+ *
+ * @param mask Tetromino mask.
+ * @param y Row inside tetromino (0-3).
+ * @param posX Field column of tetromino left corner.
+ */
+inline Row pieceRow(uint16_t mask, int y, int posX) {
+    unsigned int pixels = (mask >> (tetrominoWidth * y)) & 0xF;
+    return (posX >= 0 ? pixels << posX : pixels >> -posX) & fullRow;
+}
+
+/**
+ * Checking if tetromino fits using row bitmasks.
+ *
+ * Pixels above the field are ignored, as in doesPieceFit(), but
+ * walls extend above it, so piece kicked up can't pass them.
+ *
+ * @param board Board to check against.
+ * @param tetrominoIndex Tetromino index to check (0-6).
+ * @param r Rotate index (0-3).
+ * @param posX, posY Coordinates of top left
+ *   corner of tetromino.
+ * @return if tetromino fits.
+ */
+inline bool pieceFits(const Board &board, int tetrominoIndex, int r, int posX,
+                      int posY) {
+
+    uint16_t mask = pieceMasks[tetrominoIndex][r];
+    countEvent(counterCollisionChecks);
+
+    unsigned int columns = (mask | mask >> 4 | mask >> 8 | mask >> 12) & 0xF;
+    if (posX + __builtin_ctz(columns) < 1 ||
+        posX + 31 - __builtin_clz(columns) > fieldWidth - 2) {
+        return false;
+    }
+
+    for (int y = 0; y < tetrominoWidth; y++) {
+        if (posY + y >= 0 && posY + y < fieldHeight &&
+            (pieceRow(mask, y, posX) & board.rows[posY + y])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Finding how far tetromino can fall without looping over rows.
+ *
+ * Uses lowest pixel of every tetromino column, which works
+ * because every tetromino column is contiguous.
+ *
+ * @param board Board to check against.
+ * @param tetrominoIndex Tetromino index (0-6).
+ * @param r Rotate index (0-3).
+ * @param posX, posY Coordinates of top left corner of fitting tetromino.
+ * @return Number of rows tetromino can move down.
+ */
+inline int dropDistance(const Board &board, int tetrominoIndex, int r,
+                        int posX, int posY) {
+
+    int distance = fieldHeight;
+
+    for (int x = 0; x < tetrominoWidth; x++) {
+        int bottom = pieceBottoms[tetrominoIndex][r][x];
+        if (bottom < 0 || posX + x < 0 || posX + x >= fieldWidth) {
+            continue;
+        }
+
+        // Rows above the field are always empty.
+        int start = posY + bottom + 1;
+        Column below = board.cols[posX + x];
+        int skipped = 0;
+        if (start < 0) {
+            skipped = -start;
+        } else {
+            below = start < fieldHeight ? below >> start : 0;
+        }
+
+        int empty = below ? __builtin_ctz(below) + skipped : fieldHeight;
+        distance = empty < distance ? empty : distance;
+    }
+
+    return distance;
+}
+
+void initBoard(Board &board);
+void lockPiece(Board &board, int tetrominoIndex, int r, int posX, int posY);
+int findLines(const Board &board, int posY, int lines[tetrominoWidth]);
+void removeLines(Board &board, const int lines[], int count);
+void insertGarbage(Board &board, int count, int hole);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef bot
+#define bot
+
+#include "engine.h"
+#include "placement.h"
+
+/**
+ * Policy choosing where to place current piece.
+ *
+ * @param game Game to play, not changed.
+ * @param random Generator state owned by the player.
+ * @return Chosen placement.
+ */
+typedef Placement (*BotPolicy)(const Game &game, uint64_t &random);
+
+struct Bot {
+    const char *name;
+    BotPolicy choose;
+};
+
+extern const Bot bots[];
+extern const int botCount;
+
+int findBot(const char *name);
+double evaluateBoard(const Board &board, int lines);
+int playMatch(const int players[], int playerCount, uint64_t seed,
+              int maxPieces, int scores[]);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef corpus
+#define corpus
+
+#include <string>
+#include <vector>
+#include "engine.h"
+#include "verify.h"
+
+/**
+ * Recorded game with outcome engine must keep producing.
+ *
+ * Any change to collision, rotation, scoring or piece order
+ * changes some hash, see checkGoldenGames().
+ */
+struct GoldenGame {
+    GameOptions options;
+    int64_t endTime; // Game is played up to this time unless it is over.
+    std::vector<InputEvent> inputs;
+    std::vector<uint32_t> hashes; // Of game after every locked piece.
+    int score;
+    int lines;
+    int level;
+};
+
+void recordGoldenGame(GoldenGame &golden, const GameOptions &options,
+                      int maxPieces, uint64_t &random);
+void playGoldenGame(const GoldenGame &golden, Game &game,
+                    std::vector<uint32_t> &hashes);
+bool checkGoldenGame(const GoldenGame &golden, std::string &difference);
+int checkGoldenGames(const std::vector<GoldenGame> &games, int threadCount,
+                     std::string &difference);
+bool readGoldenGames(const char *path, std::vector<GoldenGame> &games);
+bool writeGoldenGames(const char *path, const std::vector<GoldenGame> &games);
+
+#endif
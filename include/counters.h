@@ -0,0 +1,39 @@
+#ifndef counters
+#define counters
+
+#include <cstdint>
+
+// Hot path events. Rotations, locks and lines are counted only
+// in profiling builds, see instrument.h.
+const int counterCollisionChecks = 0;
+const int counterCellsWritten = 1;
+const int counterBytesEmitted = 2;
+const int counterTickOverruns = 3;
+const int counterInputEvents = 4;
+const int counterTicks = 5;
+const int counterRotations = 6;
+const int counterLocks = 7;
+const int counterLinesCleared = 8;
+const int counterCount = 9;
+
+extern const char *const counterNames[counterCount];
+
+// Counters of calling thread, read by other threads. Only owner
+// thread writes them, so relaxed load and store compile to plain
+// increment.
+extern __thread uint64_t threadCounters[counterCount];
+
+/**
+ * Counting event on calling thread.
+ */
+inline void countEvent(int counter, uint64_t amount = 1) {
+    uint64_t &value = threadCounters[counter];
+    __atomic_store_n(&value, __atomic_load_n(&value, __ATOMIC_RELAXED) + amount,
+                     __ATOMIC_RELAXED);
+}
+
+void registerCounters();
+void sumCounters(uint64_t totals[counterCount]);
+void printCounters(const uint64_t totals[counterCount]);
+
+#endif
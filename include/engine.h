@@ -0,0 +1,100 @@
+#ifndef engine
+#define engine
+
+#include "bitboard.h"
+#include "preview.h"
+#include "spin.h"
+
+// Gravity is gravity / gravityUnit cells per tick. Unit is divisible
+// by every number of ticks per cell up to 16 and by 20.
+const int gravityUnit = 720720;
+const int gravity20G = 20 * gravityUnit;
+
+/**
+ * Rules chosen at game creation.
+ */
+struct GameOptions {
+    bool useSrs = false; // Super Rotation System instead of in place rotation.
+    int spinMode = spinModeOff;
+    int ruleset = 0; // Index in rulesets, see scoring.h.
+    uint64_t seed = 0;
+    bool useBag = false;  // 7-bag randomizer instead of independent pieces.
+    int previewDepth = 1; // Visible upcoming pieces (1-6).
+
+    // Timing, in microseconds.
+    int tickTime = 25000;
+    int dasTime = -1;  // Delay before auto shift, -1 moves once per press.
+    int arrTime = 33000; // Auto repeat interval, 0 shifts to the wall.
+    int lockDelay = 0; // 0 locks as soon as gravity finds no room.
+    bool gravity20G = false; // Drop pieces to the floor at every tick.
+};
+
+// Keys of timestamped input.
+const int keyLeft = 0;
+const int keyRight = 1;
+const int keyDown = 2;
+const int keyRotateRight = 3;
+const int keyRotateLeft = 4;
+const int keyHold = 5;
+const int keyCount = 6;
+
+// Moves and rotations which can delay lock of grounded piece.
+const int maxLockResets = 15;
+
+/**
+ * State of one game, independent of terminal.
+ */
+struct Game {
+    Board board;
+
+    GameOptions options;
+
+    bool isGameOver;
+    int currentPiece;
+    int currentRotation;
+    int currentX;
+    int currentY;
+    int lastKick;  // Kick test of last successful rotation, -1 after move.
+    int lastSpin;  // Spin of last locked piece.
+
+    PieceQueue queue;
+    int holdPiece; // -1 if hold is empty.
+    bool holdUsed; // Hold can be used once per piece.
+
+    // Timing, in microseconds since game start.
+    int64_t time;
+    int64_t nextTick;
+    int heldKey;       // Auto shifting key, -1 if none.
+    int64_t shiftTime; // Time of next auto shift.
+    int64_t lockTime;  // Time to lock grounded piece, -1 if not grounded.
+    int lockResets;
+
+    // Game speed.
+    int gravity;
+    int gravityCounter; // Fraction of cell piece has fallen.
+    int pieceCount;
+    int score;
+    int level;
+    int lines;
+    int combo;       // Consecutive line clears minus one, -1 if none.
+    bool backToBack; // Last line clear was tetris or spin.
+
+    // Versus.
+    int lastLines; // Lines cleared by last locked piece.
+    int attack;    // Garbage lines to send, taken by versus.
+};
+
+void initGame(Game &game, const GameOptions &options);
+bool movePiece(Game &game, int dx, int dy);
+bool rotatePiece(Game &game, int direction);
+bool holdCurrentPiece(Game &game);
+void dropPiece(Game &game);
+bool placePiece(Game &game, int r, int x);
+void tickGame(Game &game);
+void pressKey(Game &game, int key, int64_t time);
+void releaseKey(Game &game, int key, int64_t time);
+void advanceGame(Game &game, int64_t time);
+int64_t nextEventTime(const Game &game);
+void addGarbage(Game &game, int lines, int hole);
+
+#endif
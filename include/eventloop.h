@@ -0,0 +1,69 @@
+#ifndef eventloop
+#define eventloop
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "server.h"
+#include "spectator.h"
+#include "terminal.h"
+#include "timerwheel.h"
+#include "verify.h"
+
+/**
+ * Game of one connected client.
+ */
+struct Session {
+    int fd; // -1 for simulated game.
+    int id; // Number spectators choose game by.
+    Game game;
+    int64_t startTime;
+    TimerNode timer; // Next game event or key release.
+    int heldKey; // -1 if none.
+    int64_t heldKeyTime;
+    Verifier verifier; // Checks of timestamped inputs.
+    std::string line;  // Incomplete timestamped input.
+
+    Frame frame;           // Frame shown by client.
+    bool hasFrame;         // False until first frame is sent.
+    std::string output;    // Bytes not yet accepted by socket.
+    size_t written;        // Sent part of output.
+    bool isWaiting;        // Socket is watched for writability.
+    bool isClosing;        // Closed once output is sent.
+
+    Frame published;                 // Frame last sent to spectators.
+    std::vector<Spectator *> viewers;
+};
+
+/**
+ * Epoll instance with sessions it serves.
+ */
+struct EventLoop {
+    int epollFd;
+    int timerFd;
+    TimerWheel wheel;
+    std::vector<Session *> sessions;  // Indexed by socket.
+    std::vector<Session *> simulated; // Games without client.
+    std::atomic<int> sessionCount;
+    std::map<int, Session *> games;   // By id.
+
+    // Spectators choose game in any loop and are moved to
+    // loop running it.
+    std::vector<Spectator *> spectators; // Indexed by socket.
+    int wakeFd;                          // Eventfd signalling mailbox.
+    std::mutex mailboxMutex;
+    std::vector<Spectator *> mailbox;
+};
+
+void createEventLoops(Server &gameServer);
+void startEventLoops(Server &gameServer);
+void stopEventLoops(Server &gameServer);
+void freeEventLoops(Server &gameServer);
+void closeListeners(Server &gameServer);
+void registerGame(Server &gameServer, EventLoop &loop, Session *session);
+bool flushSession(Server &gameServer, EventLoop &loop, Session *session);
+void updateSession(Server &gameServer, EventLoop &loop, Session *session);
+void attachSpectator(EventLoop &loop, Spectator *viewer);
+
+#endif
@@ -1,14 +1,24 @@
 #ifndef functions
 #define functions
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <iostream>
+#include "globals.h"
 using namespace std;
 
+// Tetromino cells in row-major order, same layout as tetromino strings.
+typedef array<char, tetrominoArea> TetrominoCells;
+
 int rotate(int x, int y, int r);
-string rotateTetromino(string tetromino, int r);
+TetrominoCells rotateTetrominoCells(const string &tetromino, int r);
+uint16_t tetrominoMask(const string &tetromino);
+uint16_t rotateTetrominoMask(uint16_t mask, int r);
+void rotateAllTetrominoes(uint16_t masks[tetrominoCount][rotationCount]);
+string rotateTetromino(const string &tetromino, int r);
 void printTetromino(string tetromino);
 int power(int x, int p);
+int randomBelow(uint64_t &state, int n);
 
 #endif
-
@@ -0,0 +1,14 @@
+#ifndef fuzz
+#define fuzz
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "engine.h"
+
+bool checkGameInvariants(const Game &game, std::string &problem);
+bool fuzzGame(const uint8_t *data, size_t size, std::string &problem);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef garbage
+#define garbage
+
+#include <atomic>
+#include <cstdint>
+#include "globals.h"
+
+const int garbageQueueSize = 64; // Power of two.
+
+// Garbage lines sent for line clear, indexed by spin and number of lines.
+constexpr int attackLines[3][tetrominoWidth + 1] = {
+    {0, 0, 1, 2, 4}, {0, 0, 1, 2, 4}, {0, 2, 4, 6, 8}};
+
+// Extra garbage lines for consecutive line clears.
+const int maxComboAttack = 10;
+constexpr int comboAttackLines[maxComboAttack + 1] = {0, 0, 1, 1, 2, 2,
+                                                      3, 3, 4, 4, 4};
+
+/**
+ * Garbage attack, all lines have hole in the same column.
+ */
+struct GarbageAttack {
+    int8_t lines;
+    int8_t hole;
+};
+
+/**
+ * Lock-free queue of attacks from one board to another.
+ *
+ * Only one thread may push and only one thread may pop.
+ */
+struct GarbageQueue {
+    GarbageAttack attacks[garbageQueueSize];
+    std::atomic<unsigned int> head; // Written by consumer.
+    std::atomic<unsigned int> tail; // Written by producer.
+};
+
+/**
+ * Emptying queue, must not be used concurrently.
+ */
+inline void initGarbageQueue(GarbageQueue &queue) {
+    queue.head.store(0, std::memory_order_relaxed);
+    queue.tail.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Adding attack to queue.
+ *
+ * @return false if queue is full.
+ */
+inline bool pushGarbage(GarbageQueue &queue, GarbageAttack attack) {
+
+    unsigned int tail = queue.tail.load(std::memory_order_relaxed);
+    if (tail - queue.head.load(std::memory_order_acquire) ==
+        (unsigned int)garbageQueueSize) {
+        return false;
+    }
+
+    queue.attacks[tail % garbageQueueSize] = attack;
+    queue.tail.store(tail + 1, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * Taking attack from queue.
+ *
+ * @return false if queue is empty.
+ */
+inline bool popGarbage(GarbageQueue &queue, GarbageAttack &attack) {
+
+    unsigned int head = queue.head.load(std::memory_order_relaxed);
+    if (head == queue.tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    attack = queue.attacks[head % garbageQueueSize];
+    queue.head.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+#endif
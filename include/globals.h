@@ -4,7 +4,10 @@
 #include <string>
 
 const int tetrominoWidth = 4;
-static std::string tetromino[7] = {
+const int tetrominoArea = tetrominoWidth * tetrominoWidth;
+const int tetrominoCount = 7;
+const int rotationCount = 4;
+static std::string tetromino[tetrominoCount] = {
 	"..X...X...X...X.",
 	"..X..XX...X.....",
 	".....XX..XX.....",
@@ -18,7 +21,6 @@ const int fieldWidth = 12;
 const int fieldHeight = 18;
 const int fieldArea = fieldWidth * fieldHeight;
 
-static char field[fieldArea];
 static char screen[fieldArea];
 
 static int row, col; // Dimensions of current terminal instance.
@@ -0,0 +1,11 @@
+#ifndef handoff
+#define handoff
+
+#include "server.h"
+
+bool handOffServer(Server &gameServer, int channel);
+bool takeOverServer(Server &gameServer, const ServerOptions &options,
+                    int channel);
+int connectControlSocket(const char *path);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef histogram
+#define histogram
+
+#include <cstdint>
+#include <cstdio>
+
+// Values below 2^histogramSubBits are exact, every larger power
+// of two is split into 2^histogramSubBits buckets, so recorded
+// values are within 1/32 of real ones.
+const int histogramSubBits = 5;
+const int histogramSubBuckets = 1 << histogramSubBits;
+const int histogramBuckets = (64 - histogramSubBits) * histogramSubBuckets;
+
+/**
+ * Log-linear histogram, same idea as HdrHistogram.
+ */
+struct Histogram {
+    int64_t counts[histogramBuckets];
+    int64_t total;
+    int64_t max;
+};
+
+void initHistogram(Histogram &values);
+void recordValue(Histogram &values, int64_t value);
+int64_t valuePercentile(const Histogram &values, double percent);
+void printHistogram(FILE *file, const char *name, const Histogram &values);
+void writeHistogram(FILE *file, const char *name, const Histogram &values);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef instrument
+#define instrument
+
+#include "counters.h"
+#include "tracing.h"
+
+// Instrumentation of engine and rendering is compiled in only with
+// -DPROFILING, otherwise marks cost nothing. Profiling builds count
+// into counters and time scopes into trace, so --stats and --trace
+// of the same sources report them. Collision checks aren't marks,
+// pieceFits() counts them in every build for --stats.
+#ifdef PROFILING
+#define PROFILE_COUNT(counter, amount) countEvent(counter, amount)
+#define PROFILE_SCOPE(name) TraceScope profileScope(name)
+#else
+#define PROFILE_COUNT(counter, amount)
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef placement
+#define placement
+
+#include "bitboard.h"
+
+const int maxPlacements = rotationCount * fieldWidth;
+
+/**
+ * Final position of dropped tetromino.
+ */
+struct Placement {
+    int8_t r;
+    int8_t x;
+    int8_t y;
+};
+
+int findPlacements(const Board &board, int tetrominoIndex,
+                   Placement placements[maxPlacements]);
+uint64_t perft(const Board &board, const int pieces[], int depth);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef preview
+#define preview
+
+#include <cstdint>
+#include "globals.h"
+
+const int maxPreviewDepth = 6;
+const int pieceQueueSize = 16; // Power of two, fits preview and one batch.
+
+/**
+ * Upcoming pieces stored in ring buffer.
+ *
+ * Queue is refilled with whole batch of tetrominoCount pieces
+ * once there are not enough pieces left for the preview.
+ */
+struct PieceQueue {
+    char pieces[pieceQueueSize];
+    unsigned int head; // Index of next piece.
+    unsigned int tail; // Index after last piece.
+    uint64_t random;   // Randomizer state.
+    bool useBag;       // Every batch is shuffled bag of all tetrominoes.
+};
+
+void initQueue(PieceQueue &queue, uint64_t seed, bool useBag);
+int popPiece(PieceQueue &queue);
+
+/**
+ * Getting upcoming piece without removing it.
+ *
+ * @param i Position in queue, 0 is the next piece (up to maxPreviewDepth - 1).
+ */
+inline int peekPiece(const PieceQueue &queue, int i) {
+    return queue.pieces[(queue.head + i) % pieceQueueSize];
+}
+
+#endif
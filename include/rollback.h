@@ -0,0 +1,74 @@
+#ifndef rollback
+#define rollback
+
+#include <cstdint>
+#include "engine.h"
+
+// Snapshots kept, local game can run this many ticks
+// minus one ahead of last remote input.
+const int rollbackWindow = 16;
+
+/**
+ * Keys held during one tick, bit per key constant.
+ */
+typedef uint8_t TickInput;
+
+/**
+ * Everything simulated for one tick of two-player versus.
+ *
+ * Garbage is exchanged at the end of every tick, so state
+ * is plain data and snapshot is a copy.
+ */
+struct VersusState {
+    Game games[2];
+    uint64_t holeRandom[2];
+    TickInput held[2]; // Input of previous tick.
+    int tick;
+};
+
+/**
+ * One peer of rollback versus.
+ *
+ * Remote input is predicted to repeat the last one received.
+ * When real input differs, state is restored from snapshot
+ * and simulated again up to current tick.
+ */
+struct Rollback {
+    int local; // Index of local player.
+    VersusState state;
+    VersusState snapshots[rollbackWindow]; // State at start of tick, by tick.
+    TickInput inputs[2][rollbackWindow];   // Input used for tick, by tick.
+    int remoteTick;        // Ticks with real remote input.
+    TickInput lastRemote;  // Real remote input of last such tick.
+    int mispredicted;      // First tick simulated with wrong input, -1 if none.
+    int rollbacks;
+    int resimulatedTicks;
+};
+
+void initVersusState(VersusState &state, const GameOptions &options);
+void simulateTick(VersusState &state, const TickInput inputs[2]);
+void initRollback(Rollback &peer, int local, const GameOptions &options);
+bool advanceRollback(Rollback &peer, TickInput input);
+void receiveRemoteInput(Rollback &peer, int tick, TickInput input);
+void synchronizeRollback(Rollback &peer);
+
+/**
+ * Network conditions and result of loopback run.
+ */
+struct LoopbackTest {
+    int ticks;
+    int latency; // In ticks, one way.
+    int jitter;  // Extra random delay up to this many ticks.
+    uint64_t seed;
+
+    uint64_t hashes[2][2]; // By peer and game.
+    uint64_t expected[2];  // Hashes of games without latency.
+    int rollbacks;
+    int resimulatedTicks;
+    int stalls;            // Ticks peer waited for remote input.
+    int64_t rollbackTime;  // Nanoseconds spent in rollbacks.
+};
+
+void runLoopback(LoopbackTest &test, const GameOptions &options);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef scheduler
+#define scheduler
+
+/**
+ * Job run by worker thread.
+ *
+ * @param index Job index.
+ * @param worker Index of thread running job.
+ * @param context Data shared by all jobs.
+ */
+typedef void (*Job)(int index, int worker, void *context);
+
+void runJobs(int jobCount, int threadCount, Job job, void *context);
+
+#endif
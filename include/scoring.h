@@ -0,0 +1,99 @@
+#ifndef scoring
+#define scoring
+
+#include "engine.h"
+
+const int rulesProject = 0;
+const int rulesNes = 1;
+const int rulesGuideline = 2;
+const int rulesetCount = 3;
+const int maxLevelCount = 30;
+
+/**
+ * Scoring and leveling rules as lookup tables.
+ *
+ * Scores are indexed by number of cleared lines (0-4),
+ * spin scores also by spin (none, mini, full).
+ */
+struct Ruleset {
+    const char *name;
+    int pieceScore;                           // For every locked piece.
+    int lineScores[tetrominoWidth + 1];       // Multiplied by level.
+    int spinScores[3][tetrominoWidth + 1];    // Replace line score on spin.
+    int perfectClearScores[tetrominoWidth + 1]; // Multiplied by level.
+    int comboScore;        // Multiplied by combo and level.
+    int backToBackPercent; // Applied to line score of tetris or spin.
+    bool levelMultiplier;  // Multiply scores by level + 1.
+    int levelPieces;       // Pieces per level, 0 if leveling by lines.
+    int levelLines;        // Lines per level, 0 if leveling by pieces.
+    int maxLevel;
+    // In gravityUnit cells per tick, indexed by level before maxLevel
+    // caps it, so gravity keeps rising after scoring stops.
+    int gravity[maxLevelCount];
+};
+
+constexpr Ruleset rulesets[rulesetCount] = {
+    // Original rules of this game.
+    {"project",
+     25,
+     {0, 100, 400, 900, 1600},
+     {{0, 100, 400, 900, 1600},
+      {100, 300, 800, 900, 1600},
+      {400, 900, 1600, 2500, 1600}},
+     {0, 0, 0, 0, 0},
+     0,
+     100,
+     false,
+     10,
+     0,
+     3,
+     // 20, 15, 10 and 5 ticks per cell.
+     {36036,  48048,  72072,  144144, 144144, 144144, 144144, 144144,
+      144144, 144144, 144144, 144144, 144144, 144144, 144144, 144144,
+      144144, 144144, 144144, 144144, 144144, 144144, 144144, 144144,
+      144144, 144144, 144144, 144144, 144144, 144144}},
+    // Classic NES scoring.
+    {"nes",
+     0,
+     {0, 40, 100, 300, 1200},
+     {{0, 40, 100, 300, 1200},
+      {0, 40, 100, 300, 1200},
+      {0, 40, 100, 300, 1200}},
+     {0, 0, 0, 0, 0},
+     0,
+     100,
+     true,
+     0,
+     10,
+     29,
+     // NES frames per cell at 60 frames per second.
+     {22522, 25141, 28449, 32760, 38610, 47003, 60060, 83160, 135135,
+      180180, 216216, 216216, 216216, 270270, 270270, 270270, 360360,
+      360360, 360360, 540540, 540540, 540540, 540540, 540540, 540540,
+      540540, 540540, 540540, 540540, 1081080}},
+    // Guideline scoring with spins, combos, back-to-back and perfect clears.
+    {"guideline",
+     0,
+     {0, 100, 300, 500, 800},
+     {{0, 100, 300, 500, 800},
+      {100, 200, 400, 500, 800},
+      {400, 800, 1200, 1600, 800}},
+     {0, 800, 1200, 1800, 2000},
+     50,
+     150,
+     true,
+     0,
+     10,
+     15,
+     // Guideline (0.8 - level * 0.007) ^ level seconds per cell, up to 20G.
+     {18018, 22721, 29165, 38115, 50727, 68770, 94993, 133729, 191921,
+      280866, 419255, 638536, 992545, 1575091, 2552625, 4226049,
+      7149762, 12365329, 14414400, 14414400, 14414400, 14414400,
+      14414400, 14414400, 14414400, 14414400, 14414400, 14414400,
+      14414400, 14414400}}};
+
+int findRuleset(const char *name);
+void updateScore(Game &game, int lineCount, bool perfectClear);
+void updateLevel(Game &game);
+
+#endif
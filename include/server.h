@@ -0,0 +1,55 @@
+#ifndef server
+#define server
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "engine.h"
+#include "timerwheel.h"
+
+/**
+ * Settings of multi-session server.
+ */
+struct ServerOptions {
+    int port = 7777;             // TCP port on loopback, 0 picks free one, -1 disables TCP.
+    const char *unixPath = NULL; // Path of Unix socket, NULL disables it.
+    int threads = 2;             // Event loop threads.
+    int simulated = 0;           // Games without client, restarted when lost.
+    int spectatorPort = -1;      // TCP port for spectators, 0 picks free one, -1 disables.
+    bool verifyInputs = false;   // Clients send timestamped inputs instead of keys.
+    const char *controlPath = NULL; // Unix socket for hot restart, NULL disables it.
+    GameOptions game;            // Seed is increased for every session.
+};
+
+struct EventLoop;
+
+/**
+ * Server running games of raw-terminal clients.
+ *
+ * Every event loop thread owns its sessions, so games are
+ * never shared between threads.
+ */
+struct Server {
+    ServerOptions options;
+    int port;          // Bound TCP port, -1 if TCP is disabled.
+    int spectatorPort; // Bound spectator port, -1 if disabled.
+    int listenFds[3];  // TCP, Unix and spectator socket, -1 if not used.
+    int controlFd;     // Listening for restarted server, -1 if not used.
+    int stopFd;        // Eventfd waking all loops to stop.
+    std::atomic<bool> isHandingOff; // Loops keep games when stopped.
+    std::atomic<uint64_t> sessionSeed;
+    std::atomic<int> nextGameId;
+    std::mutex gamesMutex;
+    std::map<int, EventLoop *> games; // Loop running every game.
+    Lateness lateness; // Delays of game updates, filled by stopServer().
+    std::vector<EventLoop *> loops;
+    std::vector<std::thread> threads;
+};
+
+bool startServer(Server &gameServer, const ServerOptions &options);
+int serverSessions(const Server &gameServer);
+void stopServer(Server &gameServer);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef spectator
+#define spectator
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// Spectator this far behind gets keyframe instead.
+const int maxPendingFrames = 256;
+
+/**
+ * Encoded frame shared by all spectators of a game.
+ *
+ * Spectators of a game are served by the thread running it,
+ * so reference count isn't atomic.
+ */
+struct SharedFrame {
+    int refs;
+    std::string bytes;
+};
+
+/**
+ * Connection watching a game.
+ */
+struct Spectator {
+    int fd;
+    int game;                         // Id of watched game, -1 until chosen.
+    bool isWatching;                  // Game was found.
+    bool isWaiting;                   // Socket is watched for writability.
+    std::deque<SharedFrame *> frames; // Frames not yet sent.
+    size_t offset;                    // Sent part of first frame.
+};
+
+SharedFrame *createSharedFrame(const std::string &bytes, int refs);
+void releaseSharedFrame(SharedFrame *frame);
+void queueFrame(Spectator &viewer, SharedFrame *frame);
+void publishFrame(std::vector<Spectator *> &viewers, const std::string &bytes);
+void dropFrames(Spectator &viewer);
+void dropUnsentFrames(Spectator &viewer);
+int flushSpectator(Spectator &viewer);
+
+#endif
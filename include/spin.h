@@ -0,0 +1,89 @@
+#ifndef spin
+#define spin
+
+#include "bitboard.h"
+
+const int spinNone = 0;
+const int spinMini = 1;
+const int spinFull = 2;
+
+// Spin detection modes.
+const int spinModeOff = 0;
+const int spinModeT = 1;   // Only T-spins.
+const int spinModeAll = 2; // T-spins and immobile spins of other pieces.
+
+const int tetrominoT = 1;
+
+// Diagonal neighbours of T center in every rotation, in tetromino mask
+// layout. Front corners are the two on the side T is pointing to.
+constexpr uint16_t tSpinCorners[rotationCount] = {0x0A0A, 0xA0A0, 0x5050,
+                                                  0x0505};
+constexpr uint16_t tSpinFrontCorners[rotationCount] = {0x0202, 0x00A0,
+                                                       0x4040, 0x0500};
+
+/**
+ * Counting occupied cells under mask.
+ *
+ * Rows above the field count as occupied.
+ *
+ * @param mask Cells in tetromino mask layout.
+ * @param posX, posY Coordinates of top left corner of mask.
+ */
+inline int occupiedCells(const Board &board, uint16_t mask, int posX,
+                         int posY) {
+
+    int count = 0;
+
+    for (int y = 0; y < tetrominoWidth; y++) {
+        Row cells = pieceRow(mask, y, posX);
+        if (posY + y < 0) {
+            count += __builtin_popcount(cells);
+        } else if (posY + y < fieldHeight) {
+            count += __builtin_popcount(cells & board.rows[posY + y]);
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Detecting spin of tetromino about to lock.
+ *
+ * T-spin uses three corner rule, other pieces (and T with too few
+ * corners in all-spin mode) spin if they can't move left, right or up.
+ *
+ * @param mode One of spinMode constants.
+ * @param tetrominoIndex Locked tetromino index (0-6).
+ * @param r Rotate index (0-3).
+ * @param posX, posY Coordinates of top left corner of tetromino.
+ * @param lastKick Kick test used by last move, -1 if it wasn't rotation.
+ * @return One of spinNone, spinMini, spinFull.
+ */
+inline int detectSpin(const Board &board, int mode, int tetrominoIndex, int r,
+                      int posX, int posY, int lastKick) {
+
+    if (mode == spinModeOff || lastKick < 0) {
+        return spinNone;
+    }
+
+    if (tetrominoIndex == tetrominoT &&
+        occupiedCells(board, tSpinCorners[r], posX, posY) >= 3) {
+
+        // Last SRS kick upgrades mini T-spin to full one.
+        return (occupiedCells(board, tSpinFrontCorners[r], posX, posY) == 2 ||
+                lastKick == 4)
+                   ? spinFull
+                   : spinMini;
+    }
+
+    if (mode == spinModeAll &&
+        !pieceFits(board, tetrominoIndex, r, posX - 1, posY) &&
+        !pieceFits(board, tetrominoIndex, r, posX + 1, posY) &&
+        !pieceFits(board, tetrominoIndex, r, posX, posY - 1)) {
+        return spinMini;
+    }
+
+    return spinNone;
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef srs
+#define srs
+
+#include "globals.h"
+
+// Super Rotation System wall kicks.
+//
+// Offsets are (dx, dy) with y pointing down, tested in order until
+// the rotated tetromino fits. Indexed by kick table, rotate index
+// before rotation, direction (0: clockwise, 1: counter-clockwise)
+// and test number.
+
+const int srsKickCount = 5;
+
+const int srsTableJLSTZ = 0;
+const int srsTableI = 1;
+const int srsTableO = 2;
+
+constexpr int srsKicks[3][rotationCount][2][srsKickCount][2] = {
+    // J, L, S, T, Z.
+    {
+        {{{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}},  // 0 -> R
+         {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}}},    // 0 -> L
+        {{{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}},    // R -> 2
+         {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}}},   // R -> 0
+        {{{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}},     // 2 -> L
+         {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}}}, // 2 -> R
+        {{{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}, // L -> 0
+         {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}} // L -> 2
+    },
+    // I.
+    {
+        {{{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}},   // 0 -> R
+         {{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}}},  // 0 -> L
+        {{{0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1}},   // R -> 2
+         {{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}}},  // R -> 0
+        {{{0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2}},   // 2 -> L
+         {{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}}},  // 2 -> R
+        {{{0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1}},   // L -> 0
+         {{0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2}}}   // L -> 2
+    },
+    // O never kicks, only first test is used.
+    {}};
+
+// Kick table and number of kick tests of every tetromino.
+constexpr int srsKickTable[tetrominoCount] = {
+    srsTableI,     srsTableJLSTZ, srsTableO,    srsTableJLSTZ,
+    srsTableJLSTZ, srsTableJLSTZ, srsTableJLSTZ};
+constexpr int srsKickTests[tetrominoCount] = {5, 5, 1, 5, 5, 5, 5};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef terminal
+#define terminal
+
+#include <cstdint>
+#include <string>
+#include "engine.h"
+
+// Frame of one game, used by front-ends without ncurses.
+const int frameWidth = 40;
+const int frameHeight = fieldHeight + 1;
+
+struct Frame {
+    char cells[frameHeight][frameWidth];
+};
+
+int64_t nowMicros();
+int keyFromChar(int pressedKey, int &player);
+void drawGame(const Game &game, Frame &frame);
+void renderFrame(const Frame *previous, const Frame &next, std::string &out);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef timerwheel
+#define timerwheel
+
+#include <cstdint>
+
+// Every level has 64 slots, each slot of level spans
+// whole level below it.
+const int wheelLevels = 4;
+const int wheelSlotBits = 6;
+const int wheelSlots = 1 << wheelSlotBits;
+
+// Lateness bucket i counts delays below 2^i microseconds.
+const int latenessBuckets = 40;
+
+/**
+ * Timer linked into wheel slot, embedded in owner.
+ */
+struct TimerNode {
+    int64_t due;  // Microseconds.
+    void *owner;  // Object the timer belongs to.
+    TimerNode *next;
+    TimerNode *prev;
+};
+
+/**
+ * Histogram of how late timers fired.
+ */
+struct Lateness {
+    int64_t counts[latenessBuckets];
+    int64_t total;
+};
+
+/**
+ * Hierarchical timing wheel.
+ *
+ * Scheduling and cancelling are O(1), timers due in the same
+ * slot expire together as one batch.
+ */
+struct TimerWheel {
+    int64_t resolution; // Microseconds per slot of first level.
+    int64_t tick;       // Last expired slot time, in resolution units.
+    TimerNode slots[wheelLevels][wheelSlots]; // List heads.
+    Lateness lateness;
+};
+
+void initTimerNode(TimerNode &node);
+void initWheel(TimerWheel &wheel, int64_t resolution, int64_t time);
+void scheduleTimer(TimerWheel &wheel, TimerNode &node, int64_t due);
+void cancelTimer(TimerNode &node);
+void expireTimers(TimerWheel &wheel, int64_t time, TimerNode &expired);
+TimerNode *popTimer(TimerNode &list);
+void recordLateness(Lateness &lateness, int64_t delay);
+void mergeLateness(Lateness &to, const Lateness &from);
+int64_t latenessPercentile(const Lateness &lateness, double percent);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef tracing
+#define tracing
+
+#include <cstdint>
+
+// Events kept per thread, older ones are overwritten.
+const int traceCapacity = 1 << 16;
+
+struct TraceEvent {
+    const char *name; // Static string, not copied.
+    int64_t start;    // Nanoseconds.
+    int64_t duration; // Nanoseconds.
+};
+
+/**
+ * Measuring enclosing scope.
+ */
+struct TraceScope {
+    const char *name;
+    int64_t start;
+    TraceScope(const char *name);
+    ~TraceScope();
+};
+
+int64_t traceClock();
+void recordTrace(const char *name, int64_t start, int64_t end);
+void tracePhase(const char *name);
+bool writeTrace(const char *path);
+
+// Tracing is compiled in only with -DTRACING, otherwise
+// marks cost nothing.
+#ifdef TRACING
+#define TRACE_SCOPE(name) TraceScope traceScope(name)
+#define TRACE_PHASE(name) tracePhase(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_PHASE(name)
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef verify
+#define verify
+
+#include <cstdint>
+#include "engine.h"
+
+// Limits of human input, in presses and microseconds.
+const int maxInputRate = 30; // Presses per second on average.
+const int maxInputBurst = 10;
+const int64_t maxInputLead = 100000; // Input ahead of server clock.
+const int64_t maxInputLag = 500000;  // Authority behind server clock.
+
+// Verdicts of submitted input.
+const int inputAccepted = 0;
+const int inputOutOfOrder = 1;
+const int inputTooFast = 2;
+const int inputFromFuture = 3;
+const int inputTooLate = 4;
+const int inputInvalidKey = 5;
+const int verdictCount = 6;
+
+/**
+ * Timestamped input submitted by client.
+ */
+struct InputEvent {
+    int64_t time; // Microseconds since game start.
+    int8_t key;   // One of key constants.
+    bool isPress; // False for release.
+};
+
+/**
+ * Checks of client inputs driving authoritative game.
+ */
+struct Verifier {
+    int64_t lastTime;           // Time of last accepted input.
+    int64_t tokens;             // Press budget, see pressCost.
+    int verdicts[verdictCount]; // Inputs counted by verdict.
+};
+
+void initVerifier(Verifier &verifier);
+int submitInput(Verifier &verifier, Game &game, const InputEvent &input,
+                int64_t serverTime);
+int rejectedInputs(const Verifier &verifier);
+uint64_t hashGame(const Game &game);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef versus
+#define versus
+
+#include "engine.h"
+#include "garbage.h"
+
+const int maxPlayers = 4;
+
+/**
+ * Several games exchanging garbage.
+ *
+ * Every ordered pair of players has its own queue, so every
+ * game can be advanced by its own thread.
+ */
+struct Match {
+    int players;
+    Game games[maxPlayers];
+    GarbageQueue queues[maxPlayers][maxPlayers]; // From, to.
+    uint64_t holeRandom[maxPlayers];             // Holes of sent garbage.
+};
+
+void initMatch(Match &match, int players, const GameOptions &options);
+void sendGarbage(Match &match, int player);
+void receiveGarbage(Match &match, int player);
+int playersLeft(const Match &match);
+int matchWinner(const Match &match);
+
+#endif
@@ -0,0 +1,349 @@
+#include <cstdio>
+#include "../include/functions.h"
+#include "../include/baseline.h"
+
+/**
+ * Placing piece at the top, game is over if it does not fit.
+ */
+static void spawnReferencePiece(ReferenceGame &game) {
+
+    game.currentX = fieldWidth / 2;
+    game.currentY = 0;
+    game.currentRotation = 0;
+    game.currentPiece = popPiece(game.queue);
+
+    // Exit if piece does not fit.
+    game.isGameOver = !doesPieceFit(game, game.currentPiece,
+                                    game.currentRotation, game.currentX,
+                                    game.currentY + 1);
+}
+
+/**
+ * Starting reference game with the same pieces
+ * as engine game of the same seed.
+ */
+void initReferenceGame(ReferenceGame &game, uint64_t seed) {
+
+    // Filling play field.
+    for (int x = 0; x < fieldWidth; x++) {
+        for (int y = 0; y < fieldHeight; y++) {
+            game.field[y * fieldWidth + x] =
+                (x == 0 || x == fieldWidth - 1 || y == fieldHeight - 1) ? 9 : 0;
+        }
+    }
+
+    game.speed = 20;
+    game.speedCounter = 0;
+    game.pieceCount = 0;
+    game.score = 0;
+    game.level = 0;
+
+    initQueue(game.queue, seed, false);
+    spawnReferencePiece(game);
+}
+
+/**
+ * Checking if tetromino fits, pixel by pixel.
+ *
+ * @param tetrominoIndex Tetromino index to check (0-6).
+ * @param r Rotate index, may be
+ *   one of the following:
+ *   0: 0 degrees,
+ *   1: 90 degrees,
+ *   2: 180 degrees,
+ *   3: 270 degrees.
+ * @param posX, posY Coordinates of top left
+ *   corner of tetromino.
+ * @return if tetromino fits.
+ */
+bool doesPieceFit(const ReferenceGame &game, int tetrominoIndex, int r,
+                  int posX, int posY) {
+
+    for (int x = 0; x < tetrominoWidth; x++) {
+        for (int y = 0; y < tetrominoWidth; y++) {
+
+            // Index of rotated pixel.
+            int pi = rotate(x, y, r);
+
+            // Index of pixel in field.
+            int fi = ((posY + y) * fieldWidth) + (posX + x);
+
+            if (posX + x >= 0 && posX + x < fieldWidth) {
+                if (posY + y >= 0 && posY + y < fieldHeight) {
+
+                    // If tetromino has piece on current pixel
+                    // and current pixel on field is not empty
+                    // then piece does not fits.
+                    if (tetromino[tetrominoIndex][pi] == 'X' &&
+                        game.field[fi] != 0) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Playing one tick of the original game cycle.
+ *
+ * @param key Key read in this tick, -1 if none. Only movement
+ *   and clockwise rotation existed.
+ */
+void tickReferenceGame(ReferenceGame &game, int key) {
+
+    if (game.isGameOver) {
+        return;
+    }
+
+    // ========== GAME TIMING ==========
+
+    game.speedCounter++;
+    bool forceDown = (game.speedCounter == game.speed);
+
+    // ========== GAME LOGIC ===========
+
+    // Handling movement.
+    game.currentX -= (key == keyLeft &&
+                      doesPieceFit(game, game.currentPiece, game.currentRotation,
+                                   game.currentX - 1, game.currentY))
+                         ? 1
+                         : 0;
+    game.currentX += (key == keyRight &&
+                      doesPieceFit(game, game.currentPiece, game.currentRotation,
+                                   game.currentX + 1, game.currentY))
+                         ? 1
+                         : 0;
+    game.currentY += (key == keyDown &&
+                      doesPieceFit(game, game.currentPiece, game.currentRotation,
+                                   game.currentX, game.currentY + 1))
+                         ? 1
+                         : 0;
+    game.currentRotation +=
+        (key == keyRotateRight &&
+         doesPieceFit(game, game.currentPiece, game.currentRotation + 1,
+                      game.currentX, game.currentY))
+            ? 1
+            : 0;
+
+    // Handling game.
+    if (!forceDown) {
+        return;
+    }
+    game.speedCounter = 0;
+
+    if (doesPieceFit(game, game.currentPiece, game.currentRotation,
+                     game.currentX, game.currentY + 1)) {
+        game.currentY++;
+        return;
+    }
+
+    // Lock current piece in field.
+    for (int x = 0; x < tetrominoWidth; x++) {
+        for (int y = 0; y < tetrominoWidth; y++) {
+            if (tetromino[game.currentPiece]
+                         [rotate(x, y, game.currentRotation)] == 'X') {
+                game.field[(game.currentY + y) * fieldWidth +
+                           (game.currentX + x)] = game.currentPiece + 1;
+            }
+        }
+    }
+
+    // Increase piece number.
+    game.pieceCount++;
+    if (game.pieceCount % 10 == 0) {
+        if (game.speed > 5) {
+            game.level += 1;
+            game.speed -= 5;
+        }
+    }
+
+    // Check if we got any lines.
+    vector<int> lines;
+    for (int y = 0; y < tetrominoWidth; y++) {
+        if (game.currentY + y < fieldHeight - 1) {
+
+            bool line = true;
+            for (int x = 1; x < fieldWidth - 1; x++) {
+                line &= (game.field[(game.currentY + y) * fieldWidth + x]) != 0;
+            }
+
+            if (line) {
+                lines.push_back(game.currentY + y);
+            }
+        }
+    }
+
+    // Increasing score.
+    game.score += 25;
+    if (!lines.empty()) {
+        game.score += power(lines.size(), 2) * 100;
+    }
+
+    // Removing line.
+    for (int v : lines) {
+        for (int x = 1; x < fieldWidth - 1; x++) {
+            for (int y = v; y > 0; y--) {
+                game.field[y * fieldWidth + x] = game.field[(y - 1) * fieldWidth + x];
+            }
+            game.field[x] = 0;
+        }
+    }
+
+    // Choose next piece.
+    spawnReferencePiece(game);
+}
+
+/**
+ * Comparing reference game with engine game, including
+ * bitboards of engine against its own field.
+ *
+ * @param difference Output description of first difference.
+ * @return if games are the same.
+ */
+static bool compareGames(const ReferenceGame &original, const Game &game,
+                         std::string &difference) {
+
+    char text[128];
+    const char *names[7] = {"game over", "piece", "rotation", "x",
+                            "y",         "score", "pieces"};
+    int values[7][2] = {
+        {original.isGameOver, game.isGameOver},
+        {original.currentPiece, game.currentPiece},
+        {original.currentRotation % rotationCount, game.currentRotation},
+        {original.currentX, game.currentX},
+        {original.currentY, game.currentY},
+        {original.score, game.score},
+        {original.pieceCount, game.pieceCount}};
+    for (int i = 0; i < 7; i++) {
+        if (values[i][0] != values[i][1]) {
+            snprintf(text, sizeof(text), "%s: reference %d, engine %d",
+                     names[i], values[i][0], values[i][1]);
+            difference = text;
+            return false;
+        }
+    }
+
+    for (int y = 0; y < fieldHeight; y++) {
+        for (int x = 0; x < fieldWidth; x++) {
+            int cell = game.board.field[y * fieldWidth + x];
+            bool isRowSet = (game.board.rows[y] >> x) & 1;
+            bool isColumnSet = (game.board.cols[x] >> y) & 1;
+            if (original.field[y * fieldWidth + x] != cell) {
+                snprintf(text, sizeof(text),
+                         "field at x %d, y %d: reference %d, engine %d", x, y,
+                         original.field[y * fieldWidth + x], cell);
+                difference = text;
+                return false;
+            }
+            if (isRowSet != (cell != 0) || isColumnSet != (cell != 0)) {
+                snprintf(text, sizeof(text),
+                         "bitboard at x %d, y %d: cell %d, row %d, column %d",
+                         x, y, cell, isRowSet, isColumnSet);
+                difference = text;
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Playing the same keys on reference and engine games
+ * and comparing them after every tick.
+ *
+ * Engine gets key just before tick, as original cycle read
+ * key before moving piece down.
+ *
+ * Original spawn checked only the row below, so its piece could
+ * appear over cells locked at the top. Engine ends game there on
+ * purpose, see spawnPiece(). Such spawn is reported as known
+ * difference only if engine game is over at that tick and agrees
+ * in everything else, otherwise it is divergence like any other.
+ *
+ * @param seed Seed of piece queue of both games.
+ * @param keys Key of every tick, -1 if none.
+ * @param difference Output description of first difference.
+ * @return Index of first tick where games differ, noDivergence
+ *   or knownSpawnDifference.
+ */
+int findDivergence(uint64_t seed, const std::vector<int8_t> &keys,
+                   std::string &difference) {
+
+    ReferenceGame original;
+    initReferenceGame(original, seed);
+    GameOptions options;
+    options.seed = seed;
+    Game game;
+    initGame(game, options);
+
+    if (!compareGames(original, game, difference)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < keys.size() && !original.isGameOver; i++) {
+        int64_t time = (int64_t)(i + 1) * options.tickTime;
+        tickReferenceGame(original, keys[i]);
+        if (keys[i] >= 0) {
+            pressKey(game, keys[i], time - 1);
+        }
+        advanceGame(game, time);
+
+        bool isSpawnedOver = !original.isGameOver &&
+                             !doesPieceFit(original, original.currentPiece,
+                                           original.currentRotation,
+                                           original.currentX, original.currentY);
+        if (isSpawnedOver) {
+            ReferenceGame ended = original;
+            ended.isGameOver = true;
+            if (!compareGames(ended, game, difference)) {
+                return i;
+            }
+            difference = "piece spawned over locked cells, engine ended game";
+            return knownSpawnDifference;
+        }
+
+        if (!compareGames(original, game, difference)) {
+            return i;
+        }
+    }
+
+    return noDivergence;
+}
+
+/**
+ * Shortening keys which make games differ, keeping only
+ * keys without which they don't. Removing key changes later
+ * pieces, so passes repeat until none can be removed.
+ */
+void shrinkDivergence(uint64_t seed, std::vector<int8_t> &keys) {
+
+    std::string difference;
+    int tick = findDivergence(seed, keys, difference);
+    if (tick < 0) {
+        return;
+    }
+    keys.resize(tick + 1);
+
+    bool isShrunk = true;
+    while (isShrunk) {
+        isShrunk = false;
+        for (int i = keys.size() - 1; i >= 0; i--) {
+            if (i >= (int)keys.size() || keys[i] < 0) {
+                continue;
+            }
+            int8_t key = keys[i];
+            keys[i] = -1;
+            int shorter = findDivergence(seed, keys, difference);
+            if (shorter < 0) {
+                keys[i] = key;
+            } else {
+                keys.resize(shorter + 1);
+                isShrunk = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#include <cstring>
+#include "../include/bitboard.h"
+
+/**
+ * Filling board with empty field surrounded by walls.
+ */
+void initBoard(Board &board) {
+
+    for (int x = 0; x < fieldWidth; x++) {
+        for (int y = 0; y < fieldHeight; y++) {
+            board.field[y * fieldWidth + x] =
+                (x == 0 || x == fieldWidth - 1 || y == fieldHeight - 1) ? 9 : 0;
+        }
+    }
+
+    for (int y = 0; y < fieldHeight; y++) {
+        board.rows[y] = (y == fieldHeight - 1) ? fullRow : wallRow;
+    }
+
+    for (int x = 0; x < fieldWidth; x++) {
+        board.cols[x] = (x == 0 || x == fieldWidth - 1)
+                            ? (1u << fieldHeight) - 1
+                            : 1u << (fieldHeight - 1);
+    }
+
+    board.cells = 0;
+}
+
+/**
+ * Locking tetromino in field.
+ *
+ * Pixels outside of the field are not written.
+ *
+ * @param tetrominoIndex Tetromino index to lock (0-6).
+ * @param r Rotate index (0-3).
+ * @param posX, posY Coordinates of top left
+ *   corner of tetromino.
+ */
+void lockPiece(Board &board, int tetrominoIndex, int r, int posX, int posY) {
+
+    uint16_t mask = pieceMasks[tetrominoIndex][r];
+
+    for (int y = 0; y < tetrominoWidth; y++) {
+        if (posY + y < 0 || posY + y >= fieldHeight) {
+            continue;
+        }
+
+        Row pixels = pieceRow(mask, y, posX) & ~board.rows[posY + y];
+        board.rows[posY + y] |= pixels;
+        board.cells += __builtin_popcount(pixels);
+
+        for (int x = 0; x < fieldWidth; x++) {
+            if (pixels & (1 << x)) {
+                board.field[(posY + y) * fieldWidth + x] = tetrominoIndex + 1;
+                board.cols[x] |= 1u << (posY + y);
+            }
+        }
+    }
+}
+
+/**
+ * Finding completed lines covered by tetromino.
+ *
+ * @param posY Row of top left corner of tetromino.
+ * @param lines Output rows, in increasing order.
+ * @return Number of completed lines.
+ */
+int findLines(const Board &board, int posY, int lines[tetrominoWidth]) {
+
+    int count = 0;
+
+    for (int y = 0; y < tetrominoWidth; y++) {
+        if (posY + y >= 0 && posY + y < fieldHeight - 1 &&
+            board.rows[posY + y] == fullRow) {
+            lines[count++] = posY + y;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Removing lines and moving everything above them down.
+ *
+ * @param lines Rows to remove, in increasing order.
+ * @param count Number of rows.
+ */
+void removeLines(Board &board, const int lines[], int count) {
+
+    for (int i = 0; i < count; i++) {
+        int v = lines[i];
+
+        memmove(board.rows + 1, board.rows, v * sizeof(Row));
+        memmove(board.field + fieldWidth, board.field, v * fieldWidth);
+
+        board.rows[0] = wallRow;
+        board.cells -= fieldWidth - 2;
+
+        // Column bits above removed row move one bit up.
+        Column above = (1u << v) - 1;
+        for (int x = 1; x < fieldWidth - 1; x++) {
+            board.cols[x] = ((board.cols[x] & above) << 1) |
+                            (board.cols[x] & ~(above | 1u << v));
+        }
+        for (int x = 1; x < fieldWidth - 1; x++) {
+            board.field[x] = 0;
+        }
+    }
+}
+
+/**
+ * Pushing field up and filling bottom rows with garbage.
+ *
+ * Cells pushed above the field are lost.
+ *
+ * @param count Number of garbage rows (1 to fieldHeight - 1).
+ * @param hole Column left empty in every garbage row (1-10).
+ */
+void insertGarbage(Board &board, int count, int hole) {
+
+    int floor = fieldHeight - 1;
+    Row garbageRow = fullRow & ~(1 << hole);
+
+    for (int y = 0; y < count; y++) {
+        board.cells -= __builtin_popcount(board.rows[y] & ~wallRow);
+    }
+
+    memmove(board.rows, board.rows + count, (floor - count) * sizeof(Row));
+    memmove(board.field, board.field + count * fieldWidth,
+            (floor - count) * fieldWidth);
+
+    for (int y = floor - count; y < floor; y++) {
+        board.rows[y] = garbageRow;
+        for (int x = 1; x < fieldWidth - 1; x++) {
+            board.field[y * fieldWidth + x] = x == hole ? 0 : 8;
+        }
+    }
+    board.cells += count * (fieldWidth - 3);
+
+    // Column bits move down, garbage rows are set below them.
+    Column floorBit = 1u << floor;
+    Column garbageBits = floorBit - (1u << (floor - count));
+    for (int x = 1; x < fieldWidth - 1; x++) {
+        board.cols[x] = ((board.cols[x] & ~floorBit) >> count) | floorBit |
+                        (x == hole ? 0 : garbageBits);
+    }
+}
@@ -0,0 +1,176 @@
+#include <cstring>
+#include "../include/bot.h"
+#include "../include/functions.h"
+#include "../include/scoring.h"
+#include "../include/versus.h"
+
+/**
+ * Rating board, higher is better.
+ *
+ * Uses aggregate height, holes and bumpiness computed
+ * from column bitmasks and number of cleared lines.
+ *
+ * @param board Board after lines were removed.
+ * @param lines Number of lines cleared by last piece.
+ */
+double evaluateBoard(const Board &board, int lines) {
+
+    Column floorBit = 1u << (fieldHeight - 1);
+    int totalHeight = 0;
+    int holes = 0;
+    int bumpiness = 0;
+    int previousHeight = -1;
+
+    for (int x = 1; x < fieldWidth - 1; x++) {
+        int height = fieldHeight - 1 - __builtin_ctz(board.cols[x]);
+        totalHeight += height;
+        holes += height - __builtin_popcount(board.cols[x] & ~floorBit);
+        if (previousHeight >= 0) {
+            bumpiness += height > previousHeight ? height - previousHeight
+                                                 : previousHeight - height;
+        }
+        previousHeight = height;
+    }
+
+    return -0.510066 * totalHeight + 0.760666 * lines - 0.35663 * holes -
+           0.184483 * bumpiness;
+}
+
+/**
+ * Placing piece anywhere.
+ */
+static Placement chooseRandom(const Game &game, uint64_t &random) {
+
+    Placement placements[maxPlacements];
+    int count = findPlacements(game.board, game.currentPiece, placements);
+
+    if (count == 0) {
+        Placement none = {0, (int8_t)game.currentX, 0};
+        return none;
+    }
+
+    return placements[randomBelow(random, count)];
+}
+
+/**
+ * Placing piece as low as possible.
+ */
+static Placement chooseLowest(const Game &game, uint64_t &random) {
+
+    Placement placements[maxPlacements];
+    int count = findPlacements(game.board, game.currentPiece, placements);
+    Placement best = {0, (int8_t)game.currentX, 0};
+
+    for (int i = 0; i < count; i++) {
+        if (i == 0 || placements[i].y > best.y) {
+            best = placements[i];
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Placing piece where evaluateBoard() is the best.
+ */
+static Placement chooseHeuristic(const Game &game, uint64_t &random) {
+
+    Placement placements[maxPlacements];
+    int count = findPlacements(game.board, game.currentPiece, placements);
+    Placement best = {0, (int8_t)game.currentX, 0};
+    double bestScore = 0;
+
+    for (int i = 0; i < count; i++) {
+        Board board = game.board;
+        lockPiece(board, game.currentPiece, placements[i].r, placements[i].x,
+                  placements[i].y);
+
+        int lines[tetrominoWidth];
+        int lineCount = findLines(board, placements[i].y, lines);
+        removeLines(board, lines, lineCount);
+
+        double score = evaluateBoard(board, lineCount);
+        if (i == 0 || score > bestScore) {
+            best = placements[i];
+            bestScore = score;
+        }
+    }
+
+    return best;
+}
+
+const Bot bots[] = {{"random", chooseRandom},
+                    {"lowest", chooseLowest},
+                    {"heuristic", chooseHeuristic}};
+const int botCount = sizeof(bots) / sizeof(bots[0]);
+
+/**
+ * Finding bot by name.
+ *
+ * @return Bot index, -1 if there is no such bot.
+ */
+int findBot(const char *name) {
+
+    for (int i = 0; i < botCount; i++) {
+        if (strcmp(bots[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Playing versus match between bots.
+ *
+ * Result depends only on players and seed.
+ *
+ * @param players Bot indices.
+ * @param playerCount Number of players (2-4).
+ * @param seed Seed of pieces, garbage holes and bots.
+ * @param maxPieces Match is a draw after that many pieces per player.
+ * @param scores Output scores of players, may be NULL.
+ * @return Index of winner, -1 for draw.
+ */
+int playMatch(const int players[], int playerCount, uint64_t seed,
+              int maxPieces, int scores[]) {
+
+    GameOptions options;
+    options.seed = seed;
+    options.useBag = true;
+    options.ruleset = rulesGuideline;
+
+    Match match;
+    initMatch(match, playerCount, options);
+
+    uint64_t random[maxPlayers];
+    for (int i = 0; i < playerCount; i++) {
+        random[i] = (seed + i + 1) * 0xBF58476D1CE4E5B9ULL;
+    }
+
+    for (int piece = 0; piece < maxPieces && playersLeft(match) > 1;
+         piece++) {
+        for (int i = 0; i < playerCount; i++) {
+            Game &game = match.games[i];
+            if (game.isGameOver) {
+                continue;
+            }
+
+            Placement choice = bots[players[i]].choose(game, random[i]);
+            if (!placePiece(game, choice.r, choice.x)) {
+                game.isGameOver = true;
+            }
+            sendGarbage(match, i);
+        }
+
+        for (int i = 0; i < playerCount; i++) {
+            receiveGarbage(match, i);
+        }
+    }
+
+    for (int i = 0; i < playerCount && scores; i++) {
+        scores[i] = match.games[i].score;
+    }
+
+    return matchWinner(match);
+}
@@ -0,0 +1,317 @@
+#include <cinttypes>
+#include <cstdio>
+#include "../include/bot.h"
+#include "../include/corpus.h"
+#include "../include/functions.h"
+#include "../include/scheduler.h"
+#include "../include/scoring.h"
+
+/**
+ * Pressing and soon releasing key, now and then holding it
+ * long enough to auto shift.
+ */
+static void typeKey(GoldenGame &golden, Game &game, int key, int64_t &time,
+                    uint64_t &random) {
+
+    time += 20000 + randomBelow(random, 60000);
+    InputEvent press = {time, (int8_t)key, true};
+    golden.inputs.push_back(press);
+    pressKey(game, key, time);
+
+    // Releases matter only with auto shift.
+    if (game.options.dasTime < 0) {
+        return;
+    }
+    time += randomBelow(random, 8) == 0 ? 300000 : 10000 + randomBelow(random, 20000);
+    InputEvent release = {time, (int8_t)key, false};
+    golden.inputs.push_back(release);
+    releaseKey(game, key, time);
+}
+
+/**
+ * Recording keys of heuristic bot steering pieces, with random
+ * mistakes, holds and soft drops.
+ *
+ * Hashes and results are then taken from replay of recorded
+ * keys, as checkGoldenGame() will do.
+ *
+ * @param maxPieces Game ends after this many pieces.
+ * @param random Generator state of keys and bot.
+ */
+void recordGoldenGame(GoldenGame &golden, const GameOptions &options,
+                      int maxPieces, uint64_t &random) {
+
+    Game game;
+    initGame(game, options);
+    golden.options = options;
+    golden.inputs.clear();
+    const Bot &player = bots[findBot("heuristic")];
+    int64_t time = 0;
+
+    while (!game.isGameOver && game.pieceCount < maxPieces) {
+        int pieceCount = game.pieceCount;
+        Placement target = player.choose(game, random);
+
+        if (target.r == 3 && randomBelow(random, 2) == 0) {
+            typeKey(golden, game, keyRotateLeft, time, random);
+        } else {
+            for (int i = 0; i < target.r; i++) {
+                typeKey(golden, game, keyRotateRight, time, random);
+            }
+        }
+        int dx = target.x - game.currentX;
+        for (int i = 0; i < (dx < 0 ? -dx : dx); i++) {
+            typeKey(golden, game, dx < 0 ? keyLeft : keyRight, time, random);
+        }
+        if (randomBelow(random, 8) == 0) {
+            typeKey(golden, game, randomBelow(random, keyCount), time, random);
+        }
+        for (int i = randomBelow(random, 4); i > 0; i--) {
+            typeKey(golden, game, keyDown, time, random);
+        }
+
+        // Waiting for gravity to lock piece.
+        while (!game.isGameOver && game.pieceCount == pieceCount) {
+            advanceGame(game, nextEventTime(game));
+        }
+        time = game.time > time ? game.time : time;
+    }
+    golden.endTime = time + options.tickTime;
+
+    playGoldenGame(golden, game, golden.hashes);
+    golden.score = game.score;
+    golden.lines = game.lines;
+    golden.level = game.level;
+}
+
+/**
+ * Advancing game event by event, hashing it after every lock.
+ */
+static void stepGame(Game &game, int64_t time, std::vector<uint32_t> &hashes) {
+
+    while (!game.isGameOver && nextEventTime(game) <= time) {
+        int pieceCount = game.pieceCount;
+        advanceGame(game, nextEventTime(game));
+        if (game.pieceCount != pieceCount) {
+            uint64_t hash = hashGame(game);
+            hashes.push_back((uint32_t)(hash ^ hash >> 32));
+        }
+    }
+    advanceGame(game, time);
+}
+
+/**
+ * Replaying recorded keys.
+ *
+ * @param game Output game at end time.
+ * @param hashes Output hashes of game after every locked piece.
+ */
+void playGoldenGame(const GoldenGame &golden, Game &game,
+                    std::vector<uint32_t> &hashes) {
+
+    initGame(game, golden.options);
+    hashes.clear();
+
+    for (const InputEvent &input : golden.inputs) {
+        stepGame(game, input.time, hashes);
+        if (input.isPress) {
+            pressKey(game, input.key, input.time);
+        } else {
+            releaseKey(game, input.key, input.time);
+        }
+    }
+    stepGame(game, golden.endTime, hashes);
+}
+
+/**
+ * Replaying recorded game and comparing it with its outcome.
+ *
+ * @param difference Output description of first difference.
+ * @return If outcome is the same.
+ */
+bool checkGoldenGame(const GoldenGame &golden, std::string &difference) {
+
+    Game game;
+    std::vector<uint32_t> hashes;
+    playGoldenGame(golden, game, hashes);
+
+    char text[128];
+    for (size_t i = 0; i < hashes.size() && i < golden.hashes.size(); i++) {
+        if (hashes[i] != golden.hashes[i]) {
+            snprintf(text, sizeof(text), "piece %d: hash %08x, expected %08x",
+                     (int)i + 1, hashes[i], golden.hashes[i]);
+            difference = text;
+            return false;
+        }
+    }
+    if (hashes.size() != golden.hashes.size()) {
+        snprintf(text, sizeof(text), "%d pieces, expected %d",
+                 (int)hashes.size(), (int)golden.hashes.size());
+        difference = text;
+        return false;
+    }
+    if (game.score != golden.score || game.lines != golden.lines ||
+        game.level != golden.level) {
+        snprintf(text, sizeof(text),
+                 "score %d, lines %d, level %d, expected %d, %d, %d",
+                 game.score, game.lines, game.level, golden.score,
+                 golden.lines, golden.level);
+        difference = text;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Games checked by worker threads, one flag per game.
+ */
+struct GoldenCheck {
+    const std::vector<GoldenGame> *games;
+    std::vector<char> failed;
+};
+
+static void checkGoldenJob(int index, int worker, void *context) {
+
+    GoldenCheck &check = *(GoldenCheck *)context;
+    std::string difference;
+    check.failed[index] = !checkGoldenGame((*check.games)[index], difference);
+}
+
+/**
+ * Checking recorded games on worker threads.
+ *
+ * @param difference Output description of first difference.
+ * @return Index of first game with different outcome, -1 if none.
+ */
+int checkGoldenGames(const std::vector<GoldenGame> &games, int threadCount,
+                     std::string &difference) {
+
+    GoldenCheck check;
+    check.games = &games;
+    check.failed.assign(games.size(), 0);
+    runJobs(games.size(), threadCount, checkGoldenJob, &check);
+
+    for (size_t i = 0; i < games.size(); i++) {
+        if (check.failed[i]) {
+            checkGoldenGame(games[i], difference);
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Reading games written by writeGoldenGames().
+ *
+ * @return False if file can't be read or is malformed.
+ */
+bool readGoldenGames(const char *path, std::vector<GoldenGame> &games) {
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    // Skipping comment lines.
+    int c;
+    while ((c = fgetc(file)) == '#') {
+        while ((c = fgetc(file)) != '\n' && c != EOF) {
+        }
+    }
+    ungetc(c, file);
+
+    GoldenGame golden;
+    GameOptions &options = golden.options;
+    char ruleset[32];
+    int useSrs, useBag, gravity20G, count;
+    bool isRead = true;
+    while (isRead && fscanf(file, " game %" SCNu64 " %31s %d %d %d %d %d %d %d %d %d %" SCNd64,
+                            &options.seed, ruleset, &useSrs, &options.spinMode,
+                            &useBag, &options.previewDepth, &options.tickTime,
+                            &options.dasTime, &options.arrTime,
+                            &options.lockDelay, &gravity20G,
+                            &golden.endTime) == 12) {
+        options.ruleset = findRuleset(ruleset);
+        options.useSrs = useSrs;
+        options.useBag = useBag;
+        options.gravity20G = gravity20G;
+        isRead = options.ruleset >= 0;
+
+        // Input times are stored as differences.
+        isRead = isRead && fscanf(file, " inputs %d", &count) == 1 && count >= 0;
+        golden.inputs.resize(isRead ? count : 0);
+        int64_t time = 0;
+        for (int i = 0; isRead && i < count; i++) {
+            long long delay;
+            char action;
+            int key;
+            isRead = fscanf(file, " %lld%c%d", &delay, &action, &key) == 3 &&
+                     (action == '+' || action == '-') && key >= 0 &&
+                     key < keyCount;
+            time += delay;
+            InputEvent input = {time, (int8_t)key, action == '+'};
+            golden.inputs[i] = input;
+        }
+
+        isRead = isRead && fscanf(file, " hashes %d", &count) == 1 && count >= 0;
+        golden.hashes.resize(isRead ? count : 0);
+        for (int i = 0; isRead && i < count; i++) {
+            isRead = fscanf(file, " %x", &golden.hashes[i]) == 1;
+        }
+
+        isRead = isRead && fscanf(file, " result %d %d %d", &golden.score,
+                                  &golden.lines, &golden.level) == 3;
+        if (isRead) {
+            games.push_back(golden);
+        }
+    }
+
+    isRead = isRead && fscanf(file, " %c", ruleset) == EOF;
+    fclose(file);
+    return isRead;
+}
+
+/**
+ * Writing games, four lines each.
+ *
+ * @return False if file can't be written.
+ */
+bool writeGoldenGames(const char *path, const std::vector<GoldenGame> &games) {
+
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "# game SEED RULESET SRS SPIN BAG PREVIEW TICK DAS ARR LOCK "
+                  "20G END\n"
+                  "# inputs COUNT DELAY+KEY|DELAY-KEY...\n"
+                  "# hashes COUNT HASH...\n"
+                  "# result SCORE LINES LEVEL\n");
+    for (const GoldenGame &golden : games) {
+        const GameOptions &options = golden.options;
+        fprintf(file, "game %" PRIu64 " %s %d %d %d %d %d %d %d %d %d %" PRId64 "\n",
+                options.seed, rulesets[options.ruleset].name, options.useSrs,
+                options.spinMode, options.useBag, options.previewDepth,
+                options.tickTime, options.dasTime, options.arrTime,
+                options.lockDelay, options.gravity20G, golden.endTime);
+
+        fprintf(file, "inputs %d", (int)golden.inputs.size());
+        int64_t time = 0;
+        for (const InputEvent &input : golden.inputs) {
+            fprintf(file, " %lld%c%d", (long long)(input.time - time),
+                    input.isPress ? '+' : '-', input.key);
+            time = input.time;
+        }
+
+        fprintf(file, "\nhashes %d", (int)golden.hashes.size());
+        for (uint32_t hash : golden.hashes) {
+            fprintf(file, " %08x", hash);
+        }
+        fprintf(file, "\nresult %d %d %d\n", golden.score, golden.lines,
+                golden.level);
+    }
+
+    return fclose(file) == 0;
+}
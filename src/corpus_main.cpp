@@ -0,0 +1,159 @@
+/*
+ * Golden games, checking that engine plays recorded keys
+ * exactly as it did when they were recorded.
+ *
+ * Files given are replayed on worker threads, first game with
+ * different outcome is printed. --record writes new file of
+ * games with random rules steered by heuristic bot.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <thread>
+#include <vector>
+#include "../include/corpus.h"
+#include "../include/functions.h"
+#include "../include/scheduler.h"
+#include "../include/scoring.h"
+
+/**
+ * Games recorded by worker threads.
+ */
+struct Recording {
+    uint64_t seed;
+    int ruleset;
+    int maxPieces;
+    std::vector<GoldenGame> games;
+};
+
+/**
+ * Recording one game, its rules are random too.
+ */
+static void recordJob(int index, int worker, void *context) {
+
+    Recording &recording = *(Recording *)context;
+    uint64_t random = (recording.seed + index) * 0x9E3779B97F4A7C15ULL | 1;
+
+    GameOptions options;
+    options.seed = recording.seed + index;
+    options.ruleset = recording.ruleset;
+    options.useSrs = randomBelow(random, 2);
+    options.spinMode = randomBelow(random, 3);
+    options.useBag = randomBelow(random, 2);
+    options.previewDepth = 1 + randomBelow(random, 6);
+    options.tickTime = randomBelow(random, 2) ? 25000 : 16667;
+    options.dasTime = randomBelow(random, 2) ? -1 : 100000 + randomBelow(random, 100000);
+    options.arrTime = randomBelow(random, 3) == 0 ? 0 : 33000;
+    options.lockDelay = randomBelow(random, 2) ? 0 : 500000;
+    options.gravity20G = randomBelow(random, 8) == 0;
+
+    recordGoldenGame(recording.games[index], options, recording.maxPieces, random);
+}
+
+/**
+ * Printing command line usage.
+ */
+static void printUsage(const char *program) {
+    printf("Usage: %s [--threads=N] FILE...\n"
+           "       %s --record=GAMES [--ruleset=NAME] [--seed=N] "
+           "[--pieces=N] FILE\n",
+           program, program);
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    int threadCount = std::thread::hardware_concurrency();
+    int recordCount = 0;
+    const char *ruleset = "project";
+    uint64_t seed = 1;
+    int maxPieces = 40;
+
+    static struct option options[] = {
+        {"threads", required_argument, NULL, 'j'},
+        {"record", required_argument, NULL, 'r'},
+        {"ruleset", required_argument, NULL, 'u'},
+        {"seed", required_argument, NULL, 's'},
+        {"pieces", required_argument, NULL, 'p'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "j:r:u:s:p:", options, NULL)) !=
+           -1) {
+        switch (option) {
+        case 'j':
+            threadCount = atoi(optarg);
+            break;
+        case 'r':
+            recordCount = atoi(optarg);
+            break;
+        case 'u':
+            ruleset = optarg;
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'p':
+            maxPieces = atoi(optarg);
+            break;
+        default:
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc || (recordCount > 0 && optind != argc - 1)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+
+    if (recordCount > 0) {
+        Recording recording;
+        recording.seed = seed;
+        recording.ruleset = findRuleset(ruleset);
+        recording.maxPieces = maxPieces;
+        if (recording.ruleset < 0) {
+            printf("Unknown ruleset: %s\n", ruleset);
+            return 1;
+        }
+        recording.games.resize(recordCount);
+        runJobs(recordCount, threadCount, recordJob, &recording);
+        if (!writeGoldenGames(argv[optind], recording.games)) {
+            perror("Can't write games");
+            return 1;
+        }
+        return 0;
+    }
+
+    bool isPassed = true;
+    for (int i = optind; i < argc; i++) {
+        std::vector<GoldenGame> games;
+        if (!readGoldenGames(argv[i], games)) {
+            printf("%s: can't read games\n", argv[i]);
+            isPassed = false;
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        std::string difference;
+        int failed = checkGoldenGames(games, threadCount, difference);
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+        if (failed >= 0) {
+            printf("%s: game %d with seed %llu differs at %s\n", argv[i],
+                   failed + 1, (unsigned long long)games[failed].options.seed,
+                   difference.c_str());
+            isPassed = false;
+        } else {
+            printf("%s: %d games in %.3f s\n", argv[i], (int)games.size(),
+                   seconds);
+        }
+    }
+    return isPassed ? 0 : 1;
+}
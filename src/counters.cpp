@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "../include/counters.h"
+
+const char *const counterNames[counterCount] = {
+    "Collision checks", "Cells written", "Bytes emitted",
+    "Tick overruns",    "Input events",  "Ticks",
+    "Rotations",        "Locks",         "Lines cleared"};
+
+__thread uint64_t threadCounters[counterCount];
+
+/**
+ * Membership of thread in sums, its counters are added
+ * to retired ones when thread exits.
+ */
+struct CounterRegistration {
+    bool isRegistered;
+    ~CounterRegistration();
+};
+
+static std::mutex countersMutex;
+static std::vector<uint64_t *> registered;
+static uint64_t retired[counterCount];
+static thread_local CounterRegistration registration;
+
+CounterRegistration::~CounterRegistration() {
+
+    if (!isRegistered) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(countersMutex);
+    for (int i = 0; i < counterCount; i++) {
+        retired[i] += threadCounters[i];
+    }
+    for (size_t i = 0; i < registered.size(); i++) {
+        if (registered[i] == threadCounters) {
+            registered.erase(registered.begin() + i);
+            break;
+        }
+    }
+}
+
+/**
+ * Including counters of calling thread in sums.
+ *
+ * Counting itself doesn't need it, so threads
+ * nobody reads don't pay for registration.
+ */
+void registerCounters() {
+
+    if (registration.isRegistered) {
+        return;
+    }
+    registration.isRegistered = true;
+    std::lock_guard<std::mutex> guard(countersMutex);
+    registered.push_back(threadCounters);
+}
+
+/**
+ * Summing counters of registered threads, including exited ones.
+ *
+ * Counters are read without stopping their threads,
+ * so sums may miss the latest events.
+ */
+void sumCounters(uint64_t totals[counterCount]) {
+
+    std::lock_guard<std::mutex> guard(countersMutex);
+    for (int i = 0; i < counterCount; i++) {
+        totals[i] = retired[i];
+        for (size_t j = 0; j < registered.size(); j++) {
+            totals[i] += __atomic_load_n(&registered[j][i], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * Printing counters with totals per tick.
+ */
+void printCounters(const uint64_t totals[counterCount]) {
+
+    uint64_t ticks = totals[counterTicks] ? totals[counterTicks] : 1;
+    printf("Ticks: %llu\n", (unsigned long long)totals[counterTicks]);
+    for (int i = 0; i < counterCount; i++) {
+        if (i != counterTicks) {
+            printf("%s: %llu (%.1f per tick)\n", counterNames[i],
+                   (unsigned long long)totals[i], (double)totals[i] / ticks);
+        }
+    }
+}
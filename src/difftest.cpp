@@ -0,0 +1,214 @@
+/*
+ * Differential testing of engine against reference game.
+ *
+ * Plays random key streams on both and compares them after every
+ * tick. First divergence is shrunk to fewest keys which still
+ * cause it and printed as keys to replay.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../include/baseline.h"
+#include "../include/functions.h"
+#include "../include/scheduler.h"
+
+// Keys of reference game and their letters.
+const int referenceKeys[] = {keyLeft, keyRight, keyDown, keyRotateRight};
+const char keyLetters[] = "adsw";
+
+/**
+ * Random streams split between workers, first divergence wins.
+ */
+struct DiffRun {
+    uint64_t seed;
+    int ticks;
+    std::mutex lock;
+    int failedGame; // -1 if none.
+};
+
+/**
+ * Making keys of one game, about one key in four ticks.
+ */
+static void randomKeys(uint64_t seed, int game, int ticks,
+                       std::vector<int8_t> &keys) {
+
+    // Xorshift state must not be zero.
+    uint64_t state = (seed ^ (uint64_t)game * 0x9E3779B97F4A7C15ULL) | 1;
+    keys.assign(ticks, -1);
+    for (int i = 0; i < ticks; i++) {
+        if (randomBelow(state, 4) == 0) {
+            keys[i] = referenceKeys[randomBelow(state, 4)];
+        }
+    }
+}
+
+/**
+ * Playing one random game on both implementations.
+ */
+static void playGame(int index, int worker, void *context) {
+
+    DiffRun &run = *(DiffRun *)context;
+    {
+        std::lock_guard<std::mutex> guard(run.lock);
+        if (run.failedGame >= 0 && run.failedGame < index) {
+            return;
+        }
+    }
+
+    std::vector<int8_t> keys;
+    randomKeys(run.seed, index, run.ticks, keys);
+    std::string difference;
+    int tick = findDivergence(run.seed + index, keys, difference);
+
+    std::lock_guard<std::mutex> guard(run.lock);
+    if (tick >= 0 && (run.failedGame < 0 || index < run.failedGame)) {
+        run.failedGame = index;
+    }
+}
+
+/**
+ * Reading keys as "TICK:KEY,...", keys are letters of keyLetters.
+ *
+ * @return False if keys can't be read.
+ */
+static bool parseKeys(const char *text, std::vector<int8_t> &keys) {
+
+    while (*text) {
+        int tick;
+        char letter;
+        int length;
+        if (sscanf(text, "%d:%c%n", &tick, &letter, &length) != 2 || tick < 0 ||
+            !strchr(keyLetters, letter) || !letter) {
+            return false;
+        }
+        if ((int)keys.size() <= tick) {
+            keys.resize(tick + 1, -1);
+        }
+        keys[tick] = referenceKeys[strchr(keyLetters, letter) - keyLetters];
+        text += length;
+        text += *text == ',' ? 1 : 0;
+    }
+    return true;
+}
+
+/**
+ * Printing keys the way parseKeys() reads them.
+ */
+static void printKeys(const std::vector<int8_t> &keys) {
+
+    bool isFirst = true;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] >= 0) {
+            printf("%s%d:%c", isFirst ? "" : ",", (int)i, keyLetters[keys[i]]);
+            isFirst = false;
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    int games = 100000;
+    int ticks = 2000;
+    uint64_t seed = 1;
+    int threadCount = std::thread::hardware_concurrency();
+    const char *replay = NULL;
+
+    static struct option options[] = {
+        {"games", required_argument, NULL, 'g'},
+        {"ticks", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 's'},
+        {"threads", required_argument, NULL, 'j'},
+        {"keys", required_argument, NULL, 'k'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "g:t:s:j:k:", options, NULL)) !=
+           -1) {
+        switch (option) {
+        case 'g':
+            games = atoi(optarg);
+            break;
+        case 't':
+            ticks = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'j':
+            threadCount = atoi(optarg);
+            break;
+        case 'k':
+            replay = optarg;
+            break;
+        default:
+            printf("Usage: %s [--games=N] [--ticks=N] [--seed=N] [--threads=N]\n"
+                   "    [--keys=TICK:KEY,...]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+
+    // Replaying reproduction printed by earlier run.
+    std::string difference;
+    if (replay) {
+        std::vector<int8_t> keys;
+        if (!parseKeys(replay, keys)) {
+            printf("Keys must be TICK:KEY,... with keys %s\n", keyLetters);
+            return 1;
+        }
+        keys.resize(keys.size() + ticks, -1);
+        int tick = findDivergence(seed, keys, difference);
+        if (tick == knownSpawnDifference) {
+            printf("Known difference: %s\n", difference.c_str());
+            return 0;
+        }
+        if (tick < 0) {
+            printf("No divergence\n");
+            return 0;
+        }
+        printf("Divergence at tick %d: %s\n", tick, difference.c_str());
+        return 1;
+    }
+
+    DiffRun run;
+    run.seed = seed;
+    run.ticks = ticks;
+    run.failedGame = -1;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    runJobs(games, threadCount, playGame, &run);
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+    printf("%d games of up to %d ticks in %.3f s, %.0f games/s\n", games, ticks,
+           seconds, seconds > 0 ? games / seconds : 0);
+
+    if (run.failedGame < 0) {
+        printf("No divergence\n");
+        return 0;
+    }
+
+    std::vector<int8_t> keys;
+    randomKeys(seed, run.failedGame, ticks, keys);
+    int tick = findDivergence(seed + run.failedGame, keys, difference);
+    printf("Game %d diverges at tick %d: %s\n", run.failedGame, tick,
+           difference.c_str());
+
+    shrinkDivergence(seed + run.failedGame, keys);
+    tick = findDivergence(seed + run.failedGame, keys, difference);
+    printf("Shrunk to tick %d: %s\nReproduce with: %s --seed=%llu --keys=",
+           tick, difference.c_str(), argv[0],
+           (unsigned long long)(seed + run.failedGame));
+    printKeys(keys);
+    return 1;
+}
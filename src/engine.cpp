@@ -0,0 +1,452 @@
+#include "../include/engine.h"
+#include "../include/garbage.h"
+#include "../include/instrument.h"
+#include "../include/scoring.h"
+#include "../include/srs.h"
+
+/**
+ * Placing piece at the top of the field.
+ *
+ * Game is over if piece overlaps locked cells or can't move down.
+ */
+static void spawnPiece(Game &game, int piece) {
+
+    game.currentPiece = piece;
+    game.currentX = fieldWidth / 2;
+    game.currentY = 0;
+    game.currentRotation = 0;
+    game.lastKick = -1;
+    game.lockTime = -1;
+    game.lockResets = 0;
+
+    game.isGameOver = !pieceFits(game.board, game.currentPiece,
+                                 game.currentRotation, game.currentX,
+                                 game.currentY) ||
+                      !pieceFits(game.board, game.currentPiece,
+                                 game.currentRotation, game.currentX,
+                                 game.currentY + 1);
+}
+
+/**
+ * Starting new game.
+ *
+ * @param options Rules of the game.
+ */
+void initGame(Game &game, const GameOptions &options) {
+
+    initBoard(game.board);
+
+    game.options = options;
+    game.lastSpin = spinNone;
+    game.holdPiece = -1;
+    game.holdUsed = false;
+
+    game.gravityCounter = 0;
+    game.pieceCount = 0;
+    game.score = 0;
+    game.level = 0;
+    game.lines = 0;
+    game.combo = -1;
+    game.backToBack = false;
+    updateLevel(game);
+
+    game.lastLines = 0;
+    game.attack = 0;
+
+    game.time = 0;
+    game.nextTick = options.tickTime;
+    game.heldKey = -1;
+    game.shiftTime = 0;
+
+    initQueue(game.queue, options.seed, options.useBag);
+    spawnPiece(game, popPiece(game.queue));
+}
+
+/**
+ * Starting, restarting or stopping lock delay after piece moved.
+ *
+ * Lock delay restarts at most maxLockResets times per piece.
+ */
+static void updateLockTimer(Game &game) {
+
+    if (game.options.lockDelay == 0) {
+        return;
+    }
+
+    if (pieceFits(game.board, game.currentPiece, game.currentRotation,
+                  game.currentX, game.currentY + 1)) {
+        game.lockTime = -1;
+    } else if (game.lockTime < 0) {
+        game.lockTime = game.time + game.options.lockDelay;
+    } else if (game.lockResets < maxLockResets) {
+        game.lockTime = game.time + game.options.lockDelay;
+        game.lockResets++;
+    }
+}
+
+/**
+ * Moving current piece if it fits.
+ *
+ * @param dx, dy Offset to move piece by.
+ * @return if piece was moved.
+ */
+bool movePiece(Game &game, int dx, int dy) {
+
+    if (!pieceFits(game.board, game.currentPiece, game.currentRotation,
+                   game.currentX + dx, game.currentY + dy)) {
+        return false;
+    }
+
+    game.currentX += dx;
+    game.currentY += dy;
+    game.lastKick = -1;
+    updateLockTimer(game);
+
+    return true;
+}
+
+/**
+ * Rotating current piece.
+ *
+ * Without SRS piece is only tested in place, with SRS
+ * kick offsets are tested in order until first one fits.
+ *
+ * @param direction 1 for clockwise, -1 for counter-clockwise.
+ * @return if piece was rotated.
+ */
+bool rotatePiece(Game &game, int direction) {
+
+    PROFILE_COUNT(counterRotations, 1);
+
+    int from = game.currentRotation;
+    int to = (from + direction + rotationCount) % rotationCount;
+    int tests = game.options.useSrs ? srsKickTests[game.currentPiece] : 1;
+    const int(*kicks)[2] =
+        srsKicks[srsKickTable[game.currentPiece]][from][direction < 0];
+
+    for (int i = 0; i < tests; i++) {
+        if (pieceFits(game.board, game.currentPiece, to,
+                      game.currentX + kicks[i][0],
+                      game.currentY + kicks[i][1])) {
+            game.currentRotation = to;
+            game.currentX += kicks[i][0];
+            game.currentY += kicks[i][1];
+            game.lastKick = i;
+            updateLockTimer(game);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Swapping current piece with held one.
+ *
+ * If hold is empty next piece from queue is taken.
+ *
+ * @return if piece was held.
+ */
+bool holdCurrentPiece(Game &game) {
+
+    if (game.holdUsed) {
+        return false;
+    }
+
+    int piece = game.holdPiece;
+    game.holdPiece = game.currentPiece;
+    spawnPiece(game, piece >= 0 ? piece : popPiece(game.queue));
+    game.holdUsed = true;
+
+    return true;
+}
+
+/**
+ * Locking current piece, removing lines and choosing next piece.
+ */
+static void lockCurrentPiece(Game &game) {
+
+    PROFILE_SCOPE("lock");
+    PROFILE_COUNT(counterLocks, 1);
+    game.lockTime = -1;
+
+    // Spin is detected before piece becomes part of the board.
+    game.lastSpin = detectSpin(game.board, game.options.spinMode,
+                               game.currentPiece, game.currentRotation,
+                               game.currentX, game.currentY, game.lastKick);
+
+    lockPiece(game.board, game.currentPiece, game.currentRotation,
+              game.currentX, game.currentY);
+
+    // Check if we got any lines.
+    int lines[tetrominoWidth];
+    int lineCount = findLines(game.board, game.currentY, lines);
+    PROFILE_COUNT(counterLinesCleared, lineCount);
+
+    // Removing line.
+    removeLines(game.board, lines, lineCount);
+
+    // Increasing score and level.
+    game.pieceCount++;
+    updateScore(game, lineCount, lineCount > 0 && game.board.cells == 0);
+    updateLevel(game);
+
+    // Garbage for opponents.
+    game.lastLines = lineCount;
+    if (lineCount > 0) {
+        game.attack += attackLines[game.lastSpin][lineCount] +
+                       comboAttackLines[game.combo < maxComboAttack
+                                            ? game.combo
+                                            : maxComboAttack];
+    }
+
+    // Choose next piece.
+    game.holdUsed = false;
+    spawnPiece(game, popPiece(game.queue));
+}
+
+/**
+ * Dropping current piece to the floor and locking it.
+ */
+void dropPiece(Game &game) {
+
+    int distance = dropDistance(game.board, game.currentPiece,
+                                game.currentRotation, game.currentX,
+                                game.currentY);
+    if (distance > 0) {
+        movePiece(game, 0, distance);
+    }
+
+    lockCurrentPiece(game);
+    game.gravityCounter = 0;
+}
+
+/**
+ * Placing current piece directly, used by bots.
+ *
+ * Piece is put at the top in given rotation and column
+ * and dropped, path to it is not checked.
+ *
+ * @param r Rotate index (0-3).
+ * @param x Column of top left corner of tetromino.
+ * @return if piece fits at the top.
+ */
+bool placePiece(Game &game, int r, int x) {
+
+    if (game.isGameOver ||
+        !pieceFits(game.board, game.currentPiece, r, x, game.currentY)) {
+        return false;
+    }
+
+    game.currentRotation = r;
+    game.currentX = x;
+    dropPiece(game);
+
+    return true;
+}
+
+/**
+ * Advancing game by one tick.
+ *
+ * Gravity is accumulated and piece is forced down by whole cells
+ * at once, landing row is computed instead of testing every cell.
+ * If there is no room below piece, it is locked or its lock delay
+ * is started.
+ */
+void tickGame(Game &game) {
+
+    game.gravityCounter += game.gravity;
+
+    if (game.gravityCounter < gravityUnit) {
+        return;
+    }
+
+    int cells = game.gravityCounter / gravityUnit;
+    int distance = dropDistance(game.board, game.currentPiece,
+                                game.currentRotation, game.currentX,
+                                game.currentY);
+    game.gravityCounter %= gravityUnit;
+
+    if (distance > 0) {
+        movePiece(game, 0, cells < distance ? cells : distance);
+    }
+
+    if (cells > distance) {
+        if (game.options.lockDelay == 0) {
+            lockCurrentPiece(game);
+        } else if (game.lockTime < 0) {
+            game.lockTime = game.time + game.options.lockDelay;
+        }
+
+        game.gravityCounter = 0;
+    }
+}
+
+/**
+ * Moving piece by held key.
+ *
+ * With zero auto repeat interval piece is moved to the wall
+ * and moved again after every tick.
+ */
+static void autoShift(Game &game) {
+
+    int dx = game.heldKey == keyLeft ? -1 : game.heldKey == keyRight ? 1 : 0;
+    int dy = game.heldKey == keyDown ? 1 : 0;
+
+    if (game.options.arrTime > 0) {
+        movePiece(game, dx, dy);
+        game.shiftTime += game.options.arrTime;
+    } else {
+        while (movePiece(game, dx, dy)) {
+        }
+        game.shiftTime = game.nextTick;
+    }
+}
+
+/**
+ * Getting time of next scheduled tick, auto shift or lock.
+ */
+int64_t nextEventTime(const Game &game) {
+
+    int64_t next = game.nextTick;
+
+    if (game.heldKey >= 0 && game.shiftTime < next) {
+        next = game.shiftTime;
+    }
+    if (game.lockTime >= 0 && game.lockTime < next) {
+        next = game.lockTime;
+    }
+
+    return next;
+}
+
+/**
+ * Running every tick, auto shift and lock scheduled up to time.
+ *
+ * Events are processed in time order, so result depends only
+ * on timestamps and not on how often this is called.
+ *
+ * @param time Microseconds since game start.
+ */
+void advanceGame(Game &game, int64_t time) {
+
+    while (!game.isGameOver) {
+        int64_t next = nextEventTime(game);
+        if (next > time) {
+            break;
+        }
+
+        game.time = next;
+
+        if (next == game.lockTime) {
+            lockCurrentPiece(game);
+        } else if (next == game.nextTick) {
+            game.nextTick += game.options.tickTime;
+            tickGame(game);
+        } else {
+            autoShift(game);
+        }
+    }
+
+    if (time > game.time) {
+        game.time = time;
+    }
+}
+
+/**
+ * Handling key press at given time.
+ *
+ * Movement keys move piece once and, with auto shift enabled,
+ * start repeating after dasTime until released. Repeated presses
+ * of held key are ignored, so terminal key repeat can be fed as is.
+ *
+ * @param key One of key constants.
+ * @param time Microseconds since game start.
+ */
+void pressKey(Game &game, int key, int64_t time) {
+
+    advanceGame(game, time);
+
+    if (game.isGameOver || (key == game.heldKey && game.options.dasTime >= 0)) {
+        return;
+    }
+
+    switch (key) {
+    case keyLeft:
+        movePiece(game, -1, 0);
+        break;
+    case keyRight:
+        movePiece(game, 1, 0);
+        break;
+    case keyDown:
+        movePiece(game, 0, 1);
+        break;
+    case keyRotateRight:
+        rotatePiece(game, 1);
+        return;
+    case keyRotateLeft:
+        rotatePiece(game, -1);
+        return;
+    case keyHold:
+        holdCurrentPiece(game);
+        return;
+    }
+
+    if (game.options.dasTime >= 0) {
+        game.heldKey = key;
+        game.shiftTime = time + game.options.dasTime;
+    }
+}
+
+/**
+ * Handling key release at given time.
+ *
+ * @param key One of key constants.
+ * @param time Microseconds since game start.
+ */
+void releaseKey(Game &game, int key, int64_t time) {
+
+    advanceGame(game, time);
+
+    if (key == game.heldKey) {
+        game.heldKey = -1;
+    }
+}
+
+/**
+ * Receiving garbage from opponent.
+ *
+ * Current piece is pushed up if garbage overlaps it,
+ * game is over if it can't be or if field overflows.
+ *
+ * @param lines Number of garbage rows.
+ * @param hole Column left empty in garbage rows (1-10).
+ */
+void addGarbage(Game &game, int lines, int hole) {
+
+    if (game.isGameOver || lines <= 0) {
+        return;
+    }
+
+    lines = lines < fieldHeight - 1 ? lines : fieldHeight - 1;
+
+    // Game is also over if locked cells are pushed out of the field.
+    bool overflow = false;
+    for (int y = 0; y < lines; y++) {
+        overflow |= game.board.rows[y] != wallRow;
+    }
+
+    insertGarbage(game.board, lines, hole);
+
+    for (int i = 0; i < lines && !pieceFits(game.board, game.currentPiece,
+                                            game.currentRotation,
+                                            game.currentX, game.currentY);
+         i++) {
+        game.currentY--;
+    }
+
+    game.isGameOver = !pieceFits(game.board, game.currentPiece,
+                                 game.currentRotation, game.currentX,
+                                 game.currentY) ||
+                      overflow;
+}
@@ -52,7 +52,7 @@ void printTetromino(string tetromino) {
 
 
 /**
- * Rotating tetromino.
+ * Rotating tetromino without heap allocations.
  *
  * @param tetromino Tetromino to rotate.
  * @param r Rotate index, may be
@@ -61,24 +61,90 @@ void printTetromino(string tetromino) {
  *     1: 90 degrees,
  *     2: 180 degrees,
  *     3: 270 degrees.
- * @return rotatedTetromino.
+ * @return Rotated tetromino cells.
  */
-string rotateTetromino(string tetromino, int r) {
+TetrominoCells rotateTetrominoCells(const string &tetromino, int r) {
 
-    string rotatedTetromino;
+    TetrominoCells rotatedTetromino;
 
     for (int y = 0; y < tetrominoWidth; y++) {
         for (int x = 0; x < tetrominoWidth; x++) {
-            int indexToAppend = rotate(x, y, r);
-            char pieceToAppend = tetromino[indexToAppend];
-            rotatedTetromino += pieceToAppend;
+            rotatedTetromino[tetrominoWidth * y + x] =
+                tetromino[rotate(x, y, r)];
         }
     }
 
     return rotatedTetromino;
 }
 
+/**
+ * Packing tetromino into bitmask.
+ *
+ * @param tetromino Tetromino representation.
+ * @return Mask where bit (4 * y + x) is set if pixel is 'X'.
+ */
+uint16_t tetrominoMask(const string &tetromino) {
+
+    uint16_t mask = 0;
+
+    for (int i = 0; i < tetrominoArea; i++) {
+        mask |= (tetromino[i] == 'X') << i;
+    }
+
+    return mask;
+}
+
+/**
+ * Rotating tetromino bitmask.
+ *
+ * @param mask Tetromino mask to rotate.
+ * @param r Rotate index, same as in rotate().
+ * @return Rotated mask.
+ */
+uint16_t rotateTetrominoMask(uint16_t mask, int r) {
+
+    uint16_t rotatedMask = 0;
+
+    for (int y = 0; y < tetrominoWidth; y++) {
+        for (int x = 0; x < tetrominoWidth; x++) {
+            rotatedMask |= ((mask >> rotate(x, y, r)) & 1)
+                           << (tetrominoWidth * y + x);
+        }
+    }
+
+    return rotatedMask;
+}
+
+/**
+ * Rotating all tetrominoes in all rotations at once.
+ *
+ * @param masks Output table indexed by tetromino and rotate index.
+ */
+void rotateAllTetrominoes(uint16_t masks[tetrominoCount][rotationCount]) {
 
+    for (int i = 0; i < tetrominoCount; i++) {
+        uint16_t mask = tetrominoMask(tetromino[i]);
+        for (int r = 0; r < rotationCount; r++) {
+            masks[i][r] = rotateTetrominoMask(mask, r);
+        }
+    }
+}
+
+/**
+ * Rotating tetromino.
+ *
+ * Thin wrapper around rotateTetrominoCells().
+ *
+ * @param tetromino Tetromino to rotate.
+ * @param r Rotate index, same as in rotate().
+ * @return rotatedTetromino.
+ */
+string rotateTetromino(const string &tetromino, int r) {
+
+    TetrominoCells rotatedTetromino = rotateTetrominoCells(tetromino, r);
+
+    return string(rotatedTetromino.begin(), rotatedTetromino.end());
+}
 
 /**
   * Make integer to the power of integer.
@@ -95,3 +161,19 @@ int power(int x, int p) {
     else
         return x * tmp * tmp;
 }
+
+/**
+ * Generating random number with xorshift64*.
+ *
+ * Same on every platform, unlike rand().
+ *
+ * @param state Generator state, must not be zero.
+ * @param n Upper bound.
+ * @return Number in range [0, n).
+ */
+int randomBelow(uint64_t &state, int n) {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 2685821657736338717ULL) >> 32) * n >> 32;
+}
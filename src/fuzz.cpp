@@ -0,0 +1,273 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../include/fuzz.h"
+#include "../include/scoring.h"
+
+// Bytes around game which engine must never write.
+const int guardSize = 64;
+const unsigned char guardByte = 0xA5;
+
+/**
+ * Game between guard bytes.
+ */
+struct GuardedGame {
+    unsigned char before[guardSize];
+    Game game;
+    unsigned char after[guardSize];
+};
+
+/**
+ * Fuzzer input read byte by byte, zeros follow its end.
+ */
+struct FuzzInput {
+    const uint8_t *data;
+    size_t size;
+    size_t position;
+};
+
+static int readByte(FuzzInput &input) {
+    return input.position < input.size ? input.data[input.position++] : 0;
+}
+
+/**
+ * Describing broken invariant.
+ *
+ * @return Always false, for returning it from checks.
+ */
+static bool breakInvariant(std::string &problem, const char *format, int x,
+                           int y) {
+
+    char text[128];
+    snprintf(text, sizeof(text), format, x, y);
+    problem = text;
+    return false;
+}
+
+/**
+ * Checking that walls are intact, bitboards agree with field and
+ * current piece is inside field and does not overlap locked cells.
+ *
+ * @param problem Output description of first broken invariant.
+ * @return If no invariant is broken.
+ */
+bool checkGameInvariants(const Game &game, std::string &problem) {
+
+    const Board &board = game.board;
+    int cells = 0;
+
+    for (int y = 0; y < fieldHeight; y++) {
+        for (int x = 0; x < fieldWidth; x++) {
+            int cell = board.field[y * fieldWidth + x];
+            bool isWall = x == 0 || x == fieldWidth - 1 || y == fieldHeight - 1;
+            if (isWall ? cell != 9 : cell < 0 || cell > 8) {
+                return breakInvariant(problem, "wrong cell value at x %d, y %d", x, y);
+            }
+
+            bool isRowSet = (board.rows[y] >> x) & 1;
+            bool isColumnSet = (board.cols[x] >> y) & 1;
+            if (isRowSet != (cell != 0) || isColumnSet != (cell != 0)) {
+                return breakInvariant(
+                    problem, "bitboards differ from field at x %d, y %d", x, y);
+            }
+            cells += !isWall && cell != 0;
+        }
+    }
+    for (int y = 0; y < fieldHeight; y++) {
+        if (board.rows[y] & ~fullRow) {
+            return breakInvariant(problem, "row %d has bits outside field", y, 0);
+        }
+    }
+    for (int x = 0; x < fieldWidth; x++) {
+        if (board.cols[x] >> fieldHeight) {
+            return breakInvariant(problem, "column %d has bits outside field", x, 0);
+        }
+    }
+    if (cells != board.cells) {
+        return breakInvariant(problem, "%d cells counted, %d in field", board.cells,
+                              cells);
+    }
+
+    if (game.score < 0 || game.level < 0 ||
+        game.level > rulesets[game.options.ruleset].maxLevel) {
+        return breakInvariant(problem, "score %d, level %d", game.score, game.level);
+    }
+    if (game.isGameOver) {
+        return true;
+    }
+
+    if (game.currentPiece < 0 || game.currentPiece >= tetrominoCount ||
+        game.currentRotation < 0 || game.currentRotation >= rotationCount) {
+        return breakInvariant(problem, "piece %d, rotation %d", game.currentPiece,
+                              game.currentRotation);
+    }
+    uint16_t mask = pieceMasks[game.currentPiece][game.currentRotation];
+    for (int i = 0; i < tetrominoWidth * tetrominoWidth; i++) {
+        int x = game.currentX + i % tetrominoWidth;
+        int y = game.currentY + i / tetrominoWidth;
+        if ((mask >> i & 1) && (x < 0 || x >= fieldWidth || y >= fieldHeight)) {
+            return breakInvariant(problem, "piece pixel outside field at x %d, y %d",
+                                  x, y);
+        }
+    }
+    if (!pieceFits(board, game.currentPiece, game.currentRotation,
+                   game.currentX, game.currentY)) {
+        return breakInvariant(problem, "piece overlaps locked cells at x %d, y %d",
+                              game.currentX, game.currentY);
+    }
+
+    return true;
+}
+
+/**
+ * Running scheduled events one by one, checking game after each.
+ */
+static bool stepGame(Game &game, int64_t time, std::string &problem) {
+
+    while (!game.isGameOver && nextEventTime(game) <= time) {
+        advanceGame(game, nextEventTime(game));
+        if (!checkGameInvariants(game, problem)) {
+            return false;
+        }
+    }
+    advanceGame(game, time);
+    return true;
+}
+
+/**
+ * Filling rows from the bottom with locked cells.
+ */
+static void fillRows(Board &board, FuzzInput &input) {
+
+    int rowCount = readByte(input) % (fieldHeight - 1);
+
+    for (int y = fieldHeight - 2; y >= fieldHeight - 1 - rowCount; y--) {
+        int pixels = readByte(input);
+        pixels |= readByte(input) << 8;
+        for (int x = 1; x < fieldWidth - 1; x++) {
+            if (pixels >> (x - 1) & 1) {
+                board.field[y * fieldWidth + x] = 1 + (x + y) % tetrominoCount;
+                board.rows[y] |= 1 << x;
+                board.cols[x] |= 1u << y;
+                board.cells++;
+            }
+        }
+    }
+}
+
+/**
+ * Playing game decoded from bytes.
+ *
+ * First bytes choose rules and locked cells of board, then
+ * every two bytes are action and delay before it. Actions are
+ * key presses and releases, garbage, drops and bot placements.
+ *
+ * @param problem Output description of first broken invariant.
+ * @return If no invariant was broken.
+ */
+bool fuzzGame(const uint8_t *data, size_t size, std::string &problem) {
+
+    FuzzInput input = {data, size, 0};
+    const int dasTimes[] = {-1, 0, 100000, 200000};
+
+    GameOptions options;
+    int flags = readByte(input);
+    options.useSrs = flags & 1;
+    options.spinMode = (flags >> 1 & 3) % 3;
+    options.useBag = flags >> 3 & 1;
+    options.gravity20G = flags >> 4 & 1;
+    options.lockDelay = flags >> 5 & 1 ? 500000 : 0;
+    options.dasTime = dasTimes[flags >> 6];
+    int rules = readByte(input);
+    options.arrTime = rules & 1 ? 0 : 33000;
+    options.ruleset = (rules >> 1) % rulesetCount;
+    options.seed = readByte(input);
+    options.seed |= readByte(input) << 8;
+
+    // Allocated alone, so sanitizers see writes past guards.
+    GuardedGame *guarded = new GuardedGame;
+    memset(guarded->before, guardByte, guardSize);
+    memset(guarded->after, guardByte, guardSize);
+    Game &game = guarded->game;
+    initGame(game, options);
+
+    // Board is filled after spawn, so game is over as if
+    // piece spawned on it.
+    fillRows(game.board, input);
+    game.isGameOver = !pieceFits(game.board, game.currentPiece,
+                                 game.currentRotation, game.currentX,
+                                 game.currentY) ||
+                      !pieceFits(game.board, game.currentPiece,
+                                 game.currentRotation, game.currentX,
+                                 game.currentY + 1);
+
+    bool isValid = checkGameInvariants(game, problem);
+    int64_t time = 0;
+    while (isValid && !game.isGameOver && input.position < input.size) {
+        int action = readByte(input);
+        time += readByte(input) * 2000;
+        isValid = stepGame(game, time, problem);
+        if (!isValid || game.isGameOver) {
+            break;
+        }
+
+        int argument = action >> 3;
+        switch (action & 7) {
+        case 6:
+            releaseKey(game, argument % keyCount, time);
+            break;
+        case 7:
+            if (argument % 3 == 0) {
+                addGarbage(game, 1 + argument / 3 % 4,
+                           1 + readByte(input) % (fieldWidth - 2));
+            } else if (argument % 3 == 1) {
+                dropPiece(game);
+            } else {
+                placePiece(game, argument / 3 % rotationCount,
+                           readByte(input) % fieldWidth - 2);
+            }
+            break;
+        default:
+            pressKey(game, action & 7, time);
+            break;
+        }
+        isValid = checkGameInvariants(game, problem);
+    }
+
+    // Letting last piece fall.
+    if (isValid) {
+        isValid = stepGame(game, time + 10000000, problem);
+    }
+
+    for (int i = 0; isValid && i < guardSize; i++) {
+        if (guarded->before[i] != guardByte || guarded->after[i] != guardByte) {
+            isValid = breakInvariant(problem, "guard byte %d overwritten, before game %d",
+                                     i, guarded->before[i] != guardByte);
+        }
+    }
+    const GameOptions &played = game.options;
+    if (isValid && (played.seed != options.seed || played.ruleset != options.ruleset ||
+                    played.tickTime != options.tickTime ||
+                    played.dasTime != options.dasTime ||
+                    played.lockDelay != options.lockDelay)) {
+        isValid = false;
+        problem = "game options overwritten";
+    }
+
+    delete guarded;
+    return isValid;
+}
+
+/**
+ * Entry point of libFuzzer, broken invariant crashes so the
+ * input is saved.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+
+    std::string problem;
+    if (!fuzzGame(data, size, problem)) {
+        fprintf(stderr, "Broken invariant: %s\n", problem.c_str());
+        abort();
+    }
+    return 0;
+}
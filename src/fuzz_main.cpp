@@ -0,0 +1,155 @@
+/*
+ * Standalone driver of fuzz target, for compilers without libFuzzer.
+ *
+ * Given files are replayed, otherwise random inputs are generated.
+ * Input of every run depends only on seed and run number, so
+ * failing run is reproduced with --seed and --run and saved to file
+ * libFuzzer can replay too.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <string>
+#include <vector>
+#include "../include/functions.h"
+#include "../include/fuzz.h"
+
+/**
+ * Making input of one run, short inputs are more likely.
+ */
+static void randomInput(uint64_t seed, uint64_t run, int maxLength,
+                        std::vector<uint8_t> &data) {
+
+    uint64_t state = (seed * 0x9E3779B97F4A7C15ULL + run) * 0xBF58476D1CE4E5B9ULL | 1;
+    int length = randomBelow(state, randomBelow(state, maxLength) + 1);
+    data.resize(length);
+    for (int i = 0; i < length; i++) {
+        data[i] = randomBelow(state, 256);
+    }
+}
+
+/**
+ * Reading whole file.
+ *
+ * @return False if file can't be read.
+ */
+static bool readInput(const char *path, std::vector<uint8_t> &data) {
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    data.clear();
+    int c;
+    while ((c = fgetc(file)) != EOF) {
+        data.push_back(c);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * Running one input, saving it if invariant is broken.
+ */
+static bool runInput(const std::vector<uint8_t> &data, const char *crashPath) {
+
+    std::string problem;
+    if (fuzzGame(data.data(), data.size(), problem)) {
+        return true;
+    }
+
+    printf("Broken invariant: %s\n", problem.c_str());
+    FILE *file = fopen(crashPath, "wb");
+    if (file && fwrite(data.data(), 1, data.size(), file) == data.size()) {
+        printf("Input saved to %s\n", crashPath);
+    }
+    if (file) {
+        fclose(file);
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    uint64_t runs = 1000000;
+    uint64_t seed = 1;
+    long long onlyRun = -1;
+    int maxLength = 512;
+    const char *crashPath = "fuzz-crash";
+
+    static struct option options[] = {
+        {"runs", required_argument, NULL, 'n'},
+        {"seed", required_argument, NULL, 's'},
+        {"run", required_argument, NULL, 'r'},
+        {"max-len", required_argument, NULL, 'l'},
+        {"crash", required_argument, NULL, 'c'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "n:s:r:l:c:", options, NULL)) !=
+           -1) {
+        switch (option) {
+        case 'n':
+            runs = strtoull(optarg, NULL, 10);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'r':
+            onlyRun = atoll(optarg);
+            break;
+        case 'l':
+            maxLength = atoi(optarg);
+            break;
+        case 'c':
+            crashPath = optarg;
+            break;
+        default:
+            printf("Usage: %s [--runs=N] [--seed=N] [--run=N] [--max-len=BYTES]\n"
+                   "    [--crash=FILE] [INPUT...]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    maxLength = maxLength > 0 ? maxLength : 1;
+
+    // Replaying saved inputs.
+    std::vector<uint8_t> data;
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            if (!readInput(argv[i], data)) {
+                printf("%s: can't read input\n", argv[i]);
+                return 1;
+            }
+            if (!runInput(data, crashPath)) {
+                printf("%s: failed\n", argv[i]);
+                return 1;
+            }
+        }
+        printf("%d inputs passed\n", argc - optind);
+        return 0;
+    }
+
+    uint64_t first = onlyRun >= 0 ? onlyRun : 0;
+    uint64_t last = onlyRun >= 0 ? onlyRun + 1 : runs;
+    uint64_t bytes = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t run = first; run < last; run++) {
+        randomInput(seed, run, maxLength, data);
+        bytes += data.size();
+        if (!runInput(data, crashPath)) {
+            printf("Reproduce with: %s --seed=%llu --run=%llu\n", argv[0],
+                   (unsigned long long)seed, (unsigned long long)run);
+            return 1;
+        }
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+    printf("%llu runs, %llu bytes in %.3f s, %.0f runs/s\n",
+           (unsigned long long)(last - first), (unsigned long long)bytes, seconds,
+           seconds > 0 ? (last - first) / seconds : 0);
+    return 0;
+}
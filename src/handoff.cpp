@@ -0,0 +1,546 @@
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../include/eventloop.h"
+#include "../include/handoff.h"
+
+// Handoff from other program is refused, see also handoffLayout.
+const uint32_t handoffMagic = 0x54455452;
+const int handoffListeners = 4; // Three of server, control socket.
+
+// Descriptors sent by one message.
+const int maxFdBatch = 250;
+
+// Time for new server to ask for games and to confirm it took them.
+const int handoffTimeout = 5; // s.
+
+/**
+ * Server state at the start of shared memory segment.
+ */
+struct HandoffHeader {
+    uint32_t magic;
+    uint64_t layout; // Hash of record layouts, see handoffLayout.
+    int sessionCount;
+    int spectatorCount;
+    int fdCount;
+    int listenIndex[handoffListeners]; // Index in descriptors, -1 if not used.
+    int nextGameId;
+    uint64_t sessionSeed;
+    Lateness lateness;
+    uint64_t size; // Bytes of whole segment.
+};
+
+/**
+ * Game of session, followed by its pending output.
+ */
+struct SessionRecord {
+    int fdIndex; // -1 for simulated game.
+    int id;
+    Game game;
+    int64_t startTime;
+    int heldKey;
+    int64_t heldKeyTime;
+    Verifier verifier;
+    char line[64];
+    Frame frame;
+    bool hasFrame;
+    bool isClosing;
+    uint64_t outputOffset; // In segment.
+    uint32_t outputLength;
+};
+
+/**
+ * Spectator watching game, followed by unsent part of its frames.
+ */
+struct SpectatorRecord {
+    int fdIndex;
+    int game;
+    uint64_t outputOffset;
+    uint32_t outputLength;
+};
+
+// Sizes and offsets of records copied into segment. Build which
+// reorders, resizes or adds members of Game, Verifier or Frame has
+// different values, and its handoff is refused.
+constexpr uint64_t layoutValues[] = {
+    sizeof(HandoffHeader),
+    sizeof(SessionRecord),
+    sizeof(SpectatorRecord),
+    offsetof(SessionRecord, game),
+    offsetof(SessionRecord, verifier),
+    offsetof(SessionRecord, frame),
+    offsetof(SessionRecord, outputOffset),
+    sizeof(Game),
+    sizeof(Board),
+    sizeof(GameOptions),
+    sizeof(PieceQueue),
+    offsetof(Game, options),
+    offsetof(Game, queue),
+    offsetof(Game, time),
+    offsetof(Game, gravity),
+    sizeof(Verifier),
+    offsetof(Verifier, verdicts),
+    sizeof(Frame)};
+
+/**
+ * Hashing layout values up to given index, FNV-1a over whole values.
+ */
+constexpr uint64_t hashLayout(int index) {
+    return index < 0 ? 14695981039346656037ull
+                     : (hashLayout(index - 1) ^ layoutValues[index]) *
+                           1099511628211ull;
+}
+
+const uint64_t handoffLayout =
+    hashLayout(sizeof(layoutValues) / sizeof(layoutValues[0]) - 1);
+
+/**
+ * Sending descriptors in batches, with one byte of data each.
+ */
+static bool sendFds(int channel, const int *fds, int count) {
+
+    for (int start = 0; start < count; start += maxFdBatch) {
+        int batch = count - start < maxFdBatch ? count - start : maxFdBatch;
+        char data = 'F';
+        iovec part = {&data, 1};
+        std::vector<char> control(CMSG_SPACE(batch * sizeof(int)));
+
+        msghdr message = {};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(batch * sizeof(int));
+        memcpy(CMSG_DATA(header), fds + start, batch * sizeof(int));
+
+        if (sendmsg(channel, &message, MSG_NOSIGNAL) != 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Receiving descriptors sent by sendFds().
+ */
+static bool receiveFds(int channel, int *fds, int count) {
+
+    for (int start = 0; start < count;) {
+        char data;
+        iovec part = {&data, 1};
+        std::vector<char> control(CMSG_SPACE(maxFdBatch * sizeof(int)));
+
+        msghdr message = {};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control.data();
+        message.msg_controllen = control.size();
+        if (recvmsg(channel, &message, MSG_CMSG_CLOEXEC) != 1) {
+            return false;
+        }
+
+        cmsghdr *header = CMSG_FIRSTHDR(&message);
+        if (!header || header->cmsg_type != SCM_RIGHTS) {
+            return false;
+        }
+        int batch = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        if (start + batch > count) {
+            return false;
+        }
+        memcpy(fds + start, CMSG_DATA(header), batch * sizeof(int));
+        start += batch;
+    }
+    return true;
+}
+
+/**
+ * Freeing handed games and closing their descriptors, other
+ * server keeps its own copies of them open.
+ *
+ * @param isNotifying Telling spectators choosing game to reconnect.
+ */
+static void freeHandedGames(Server &gameServer, bool isNotifying) {
+
+    for (size_t i = 0; i < gameServer.loops.size(); i++) {
+        EventLoop &loop = *gameServer.loops[i];
+        for (size_t fd = 0; fd < loop.spectators.size(); fd++) {
+            if (loop.spectators[fd]) {
+                if (isNotifying && !loop.spectators[fd]->isWatching) {
+                    const char text[] = "\r\nServer restarted, please reconnect\r\n";
+                    send((int)fd, text, sizeof(text) - 1, MSG_NOSIGNAL);
+                }
+                dropFrames(*loop.spectators[fd]);
+                close(fd);
+                delete loop.spectators[fd];
+            }
+        }
+        for (std::map<int, Session *>::iterator it = loop.games.begin();
+             it != loop.games.end(); it++) {
+            if (it->second->fd >= 0) {
+                close(it->second->fd);
+            }
+            delete it->second;
+        }
+    }
+    freeEventLoops(gameServer);
+    gameServer.games.clear();
+    int listeners[handoffListeners] = {
+        gameServer.listenFds[0], gameServer.listenFds[1],
+        gameServer.listenFds[2], gameServer.controlFd};
+    for (int i = 0; i < handoffListeners; i++) {
+        if (listeners[i] >= 0) {
+            close(listeners[i]);
+        }
+    }
+}
+
+/**
+ * Restarting loops stopped for handoff which failed, they keep
+ * running their games.
+ */
+static void resumeServer(Server &gameServer) {
+
+    uint64_t stops;
+    if (read(gameServer.stopFd, &stops, sizeof(stops)) != sizeof(stops)) {
+        perror("eventfd");
+    }
+    gameServer.isHandingOff = false;
+    startEventLoops(gameServer);
+}
+
+/**
+ * Stopping loops and passing every game and socket to new server.
+ *
+ * Games are written to shared memory segment sent with sockets over
+ * channel, clients keep their connections. Spectators still choosing
+ * game are disconnected. Returns once new server confirms it runs the
+ * games, server is freed then but Unix socket paths are kept.
+ *
+ * Loops are stopped only after peer asks for games, and restarted
+ * if anything fails, so failed handoff doesn't end any game.
+ *
+ * @param channel Connection from new server to control socket.
+ * @return False if new server didn't take games, server keeps running
+ * them then.
+ */
+bool handOffServer(Server &gameServer, int channel) {
+
+    // Anything else connecting to control socket is ignored.
+    timeval timeout = {handoffTimeout, 0};
+    setsockopt(channel, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    uint32_t request = 0;
+    if (recv(channel, &request, sizeof(request), MSG_WAITALL) != sizeof(request) ||
+        request != handoffMagic) {
+        return false;
+    }
+
+    gameServer.isHandingOff = true;
+    stopEventLoops(gameServer);
+
+    // Descriptors and size of segment.
+    std::vector<int> fds;
+    HandoffHeader header = {};
+    header.magic = handoffMagic;
+    header.layout = handoffLayout;
+    int listeners[handoffListeners] = {
+        gameServer.listenFds[0], gameServer.listenFds[1],
+        gameServer.listenFds[2], gameServer.controlFd};
+    for (int i = 0; i < handoffListeners; i++) {
+        header.listenIndex[i] = listeners[i] >= 0 ? (int)fds.size() : -1;
+        if (listeners[i] >= 0) {
+            fds.push_back(listeners[i]);
+        }
+    }
+
+    std::vector<Session *> sessions;
+    std::vector<Spectator *> viewers;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < gameServer.loops.size(); i++) {
+        EventLoop &loop = *gameServer.loops[i];
+        mergeLateness(header.lateness, loop.wheel.lateness);
+        for (std::map<int, Session *>::iterator it = loop.games.begin();
+             it != loop.games.end(); it++) {
+            Session *session = it->second;
+            sessions.push_back(session);
+            bytes += session->output.size() - session->written;
+            for (size_t j = 0; j < session->viewers.size(); j++) {
+                Spectator *viewer = session->viewers[j];
+                viewers.push_back(viewer);
+                for (size_t k = 0; k < viewer->frames.size(); k++) {
+                    bytes += viewer->frames[k]->bytes.size();
+                }
+            }
+        }
+    }
+
+    header.sessionCount = sessions.size();
+    header.spectatorCount = viewers.size();
+    header.nextGameId = gameServer.nextGameId;
+    header.sessionSeed = gameServer.sessionSeed;
+    header.size = sizeof(header) + sessions.size() * sizeof(SessionRecord) +
+                  viewers.size() * sizeof(SpectatorRecord) + bytes;
+
+    int segment = memfd_create("tetris-handoff", MFD_CLOEXEC);
+    char *memory = (char *)MAP_FAILED;
+    if (segment >= 0 && ftruncate(segment, header.size) == 0) {
+        memory = (char *)mmap(NULL, header.size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, segment, 0);
+    }
+    if (memory == MAP_FAILED) {
+        if (segment >= 0) {
+            close(segment);
+        }
+        resumeServer(gameServer);
+        return false;
+    }
+
+    // Writing records, pending output goes after all of them. Segment
+    // is zero-filled, so padding of records is zero.
+    SessionRecord *records = (SessionRecord *)(memory + sizeof(header));
+    SpectatorRecord *viewerRecords =
+        (SpectatorRecord *)(records + sessions.size());
+    uint64_t offset = (char *)(viewerRecords + viewers.size()) - memory;
+
+    for (size_t i = 0; i < sessions.size(); i++) {
+        Session *session = sessions[i];
+        SessionRecord &record = records[i];
+        record.fdIndex = session->fd >= 0 ? (int)fds.size() : -1;
+        if (session->fd >= 0) {
+            fds.push_back(session->fd);
+        }
+        record.id = session->id;
+        record.game = session->game;
+        record.startTime = session->startTime;
+        record.heldKey = session->heldKey;
+        record.heldKeyTime = session->heldKeyTime;
+        record.verifier = session->verifier;
+        strncpy(record.line, session->line.c_str(), sizeof(record.line) - 1);
+        record.frame = session->frame;
+        record.hasFrame = session->hasFrame;
+        record.isClosing = session->isClosing;
+        record.outputOffset = offset;
+        record.outputLength = session->output.size() - session->written;
+        memcpy(memory + offset, session->output.data() + session->written,
+               record.outputLength);
+        offset += record.outputLength;
+    }
+
+    for (size_t i = 0; i < viewers.size(); i++) {
+        Spectator *viewer = viewers[i];
+        SpectatorRecord &record = viewerRecords[i];
+        record.fdIndex = fds.size();
+        fds.push_back(viewer->fd);
+        record.game = viewer->game;
+        record.outputOffset = offset;
+        for (size_t k = 0; k < viewer->frames.size(); k++) {
+            size_t skip = k == 0 ? viewer->offset : 0;
+            const std::string &frame = viewer->frames[k]->bytes;
+            memcpy(memory + offset, frame.data() + skip, frame.size() - skip);
+            offset += frame.size() - skip;
+        }
+        record.outputLength = offset - record.outputOffset;
+    }
+
+    header.fdCount = fds.size();
+    memcpy(memory, &header, sizeof(header));
+    munmap(memory, header.size);
+
+    char confirmation = 0;
+    bool isTaken = sendFds(channel, &segment, 1) &&
+                   sendFds(channel, fds.data(), fds.size()) &&
+                   recv(channel, &confirmation, 1, MSG_WAITALL) == 1 &&
+                   confirmation == 'K';
+    close(segment);
+    if (!isTaken) {
+        resumeServer(gameServer);
+        return false;
+    }
+
+    // Freeing games, new server has its own copies of descriptors.
+    freeHandedGames(gameServer, true);
+    return true;
+}
+
+/**
+ * Starting server with games and sockets of old one.
+ *
+ * Games continue at the same game time, as both servers
+ * use the same monotonic clock.
+ *
+ * @param options Options of new server, sockets are taken
+ * from old one instead of opened.
+ * @param channel Connection to control socket of old server.
+ * @return False if handoff failed, nothing is started then and
+ * old server keeps running games.
+ */
+bool takeOverServer(Server &gameServer, const ServerOptions &options,
+                    int channel) {
+
+    uint32_t request = handoffMagic;
+    int segment;
+    if (send(channel, &request, sizeof(request), MSG_NOSIGNAL) != sizeof(request) ||
+        !receiveFds(channel, &segment, 1)) {
+        return false;
+    }
+
+    HandoffHeader header;
+    if (pread(segment, &header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != handoffMagic ||
+        header.layout != handoffLayout) {
+        close(segment);
+        return false;
+    }
+
+    char *memory =
+        (char *)mmap(NULL, header.size, PROT_READ, MAP_SHARED, segment, 0);
+    close(segment);
+    if (memory == MAP_FAILED) {
+        return false;
+    }
+    std::vector<int> fds(header.fdCount);
+    if (!receiveFds(channel, fds.data(), header.fdCount)) {
+        munmap(memory, header.size);
+        return false;
+    }
+
+    // Sockets of old server.
+    gameServer.options = options;
+    int *listeners[handoffListeners] = {
+        &gameServer.listenFds[0], &gameServer.listenFds[1],
+        &gameServer.listenFds[2], &gameServer.controlFd};
+    for (int i = 0; i < handoffListeners; i++) {
+        *listeners[i] = header.listenIndex[i] >= 0 ? fds[header.listenIndex[i]]
+                                                   : -1;
+    }
+    int *ports[2] = {&gameServer.port, &gameServer.spectatorPort};
+    for (int i = 0; i < 2; i++) {
+        *ports[i] = -1;
+        sockaddr_in address;
+        socklen_t length = sizeof(address);
+        int fd = gameServer.listenFds[2 * i];
+        if (fd >= 0 &&
+            getsockname(fd, (sockaddr *)&address, &length) == 0) {
+            *ports[i] = ntohs(address.sin_port);
+        }
+    }
+
+    gameServer.nextGameId = header.nextGameId;
+    gameServer.sessionSeed = header.sessionSeed;
+    gameServer.lateness = header.lateness;
+    createEventLoops(gameServer);
+
+    // Games are spread over loops again, spectators go to loop of game.
+    SessionRecord *records = (SessionRecord *)(memory + sizeof(header));
+    SpectatorRecord *viewerRecords =
+        (SpectatorRecord *)(records + header.sessionCount);
+    std::vector<Session *> sessions;
+
+    for (int i = 0; i < header.sessionCount; i++) {
+        const SessionRecord &record = records[i];
+        EventLoop &loop = *gameServer.loops[i % gameServer.loops.size()];
+        Session *session = new Session();
+        session->fd = record.fdIndex >= 0 ? fds[record.fdIndex] : -1;
+        session->id = record.id;
+        session->game = record.game;
+        session->startTime = record.startTime;
+        initTimerNode(session->timer);
+        session->timer.owner = session;
+        session->heldKey = record.heldKey;
+        session->heldKeyTime = record.heldKeyTime;
+        session->verifier = record.verifier;
+        session->line = record.line;
+        session->frame = record.frame;
+        session->hasFrame = record.hasFrame;
+        session->isClosing = record.isClosing;
+        session->output.assign(memory + record.outputOffset,
+                               record.outputLength);
+
+        if (session->fd >= 0) {
+            if ((int)loop.sessions.size() <= session->fd) {
+                loop.sessions.resize(session->fd + 1);
+            }
+            loop.sessions[session->fd] = session;
+            loop.sessionCount++;
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = session->fd;
+            epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, session->fd, &event);
+        } else {
+            loop.simulated.push_back(session);
+        }
+        registerGame(gameServer, loop, session);
+        sessions.push_back(session);
+    }
+
+    for (int i = 0; i < header.spectatorCount; i++) {
+        const SpectatorRecord &record = viewerRecords[i];
+        EventLoop &loop = *gameServer.games[record.game];
+        Spectator *viewer = new Spectator();
+        viewer->fd = fds[record.fdIndex];
+        viewer->game = record.game;
+        if (record.outputLength > 0) {
+            queueFrame(*viewer, createSharedFrame(
+                                    std::string(memory + record.outputOffset,
+                                                record.outputLength),
+                                    1));
+        }
+        attachSpectator(loop, viewer);
+    }
+    munmap(memory, header.size);
+
+    // Old server keeps games unless it hears they were taken, so
+    // nothing is sent to clients before.
+    char confirmation = 'K';
+    if (send(channel, &confirmation, 1, MSG_NOSIGNAL) != 1) {
+        freeHandedGames(gameServer, false);
+        return false;
+    }
+
+    // Sending what old server didn't manage, then continuing games.
+    for (size_t i = 0; i < sessions.size(); i++) {
+        Session *session = sessions[i];
+        EventLoop &loop = *gameServer.games[session->id];
+        if (session->fd >= 0 && (!session->output.empty() || session->isClosing) &&
+            !flushSession(gameServer, loop, session)) {
+            continue;
+        }
+        if (!session->isClosing) {
+            updateSession(gameServer, loop, session);
+        }
+    }
+
+    startEventLoops(gameServer);
+    return true;
+}
+
+/**
+ * Connecting to control socket of running server.
+ *
+ * @return Connected socket, -1 on failure.
+ */
+int connectControlSocket(const char *path) {
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
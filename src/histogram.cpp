@@ -0,0 +1,98 @@
+#include <cstring>
+#include "../include/histogram.h"
+
+/**
+ * Finding bucket of value.
+ */
+static int bucketIndex(int64_t value) {
+
+    if (value < histogramSubBuckets) {
+        return value < 0 ? 0 : value;
+    }
+
+    // Highest bits of value select bucket inside its power of two.
+    int shift = 63 - __builtin_clzll(value) - histogramSubBits;
+    return shift * histogramSubBuckets + (int)(value >> shift);
+}
+
+/**
+ * Getting largest value counted in bucket.
+ */
+static int64_t bucketValue(int index) {
+
+    if (index < histogramSubBuckets) {
+        return index;
+    }
+
+    int shift = index / histogramSubBuckets - 1;
+    int64_t top = index - shift * histogramSubBuckets;
+    return ((top + 1) << shift) - 1;
+}
+
+/**
+ * Creating empty histogram.
+ */
+void initHistogram(Histogram &values) {
+    memset(&values, 0, sizeof(values));
+}
+
+/**
+ * Counting value, negative ones count as 0.
+ */
+void recordValue(Histogram &values, int64_t value) {
+
+    values.counts[bucketIndex(value)]++;
+    values.total++;
+    values.max = value > values.max ? value : values.max;
+}
+
+/**
+ * Finding value below which given percent of values are.
+ *
+ * @return Largest value of bucket, 0 if histogram is empty.
+ */
+int64_t valuePercentile(const Histogram &values, double percent) {
+
+    int64_t seen = 0;
+    for (int i = 0; i < histogramBuckets; i++) {
+        seen += values.counts[i];
+        if (seen > 0 && seen >= values.total * percent / 100) {
+            int64_t value = bucketValue(i);
+            return value < values.max ? value : values.max;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Printing percentiles on one line.
+ */
+void printHistogram(FILE *file, const char *name, const Histogram &values) {
+
+    fprintf(file, "%s: p50 %lld us, p99 %lld us, p99.9 %lld us, max %lld us\n",
+            name, (long long)valuePercentile(values, 50),
+            (long long)valuePercentile(values, 99),
+            (long long)valuePercentile(values, 99.9), (long long)values.max);
+}
+
+/**
+ * Writing cumulative distribution, one line per non-empty
+ * bucket, as HdrHistogram percentile output does.
+ */
+void writeHistogram(FILE *file, const char *name, const Histogram &values) {
+
+    fprintf(file, "# %s (us)\n%12s %12s %12s\n", name, "Value", "Percentile",
+            "TotalCount");
+    int64_t seen = 0;
+    for (int i = 0; i < histogramBuckets; i++) {
+        if (values.counts[i]) {
+            seen += values.counts[i];
+            int64_t value = bucketValue(i);
+            fprintf(file, "%12lld %12.6f %12lld\n",
+                    (long long)(value < values.max ? value : values.max),
+                    (double)seen / values.total, (long long)seen);
+        }
+    }
+    fprintf(file, "#[Max = %lld, Total count = %lld]\n\n", (long long)values.max,
+            (long long)values.total);
+}
@@ -23,84 +23,354 @@
  * SOFTWARE.
  */
 
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <getopt.h>
 #include <ncurses.h>
 #include <signal.h>
+#include <string.h>
+#include <sys/select.h>
+#include <time.h>
 #include <unistd.h>
-#include <vector>
+#include "../include/counters.h"
+#include "../include/engine.h"
 #include "../include/functions.h"
+#include "../include/histogram.h"
+#include "../include/instrument.h"
+#include "../include/scoring.h"
+#include "../include/terminal.h"
+#include "../include/tracing.h"
+#include "../include/versus.h"
 #include "../include/globals.h"
 
 /**
- * Checking if tetromino fits.
+ * Printing game field.
  *
- * @param tetrominoIndex Tetromino index to check (0-6).
- * @param r Rotate index, may be
- *   one of the following:
- *   0: 0 degrees,
- *   1: 90 degrees,
- *   2: 180 degrees,
- *   3: 270 degrees.
- * @param posX, posY Coordinates of top left
- *   corner of tetromino.
- * @return if tetromino fits.
+ * @param top, left Screen coordinates of top left corner of field.
  */
-bool doesPieceFit(int tetrominoIndex, int r, int posX, int posY) {
+void printScreen(char screen[], int top, int left) {
 
+    PROFILE_SCOPE("print screen");
+    countEvent(counterCellsWritten, fieldArea);
+    for (int i = 0; i < fieldArea; i++) {
+        if (i % (fieldWidth) == 0) {
+            mvaddch(i / (fieldWidth) + top, i % (fieldWidth) + left, '\n');
+        }
+        mvaddch(i / (fieldWidth) + top, i % (fieldWidth) + left, screen[i]);
+    }
+}
+
+/**
+ * Printing small tetromino, used for hold and preview.
+ *
+ * Tetromino is drawn rotated, so it takes only two rows.
+ *
+ * @param y, x Screen coordinates of top left corner.
+ * @param piece Tetromino index (0-6), nothing is drawn if negative.
+ */
+void printPiece(int y, int x, int piece) {
+
+    for (int py = 1; py < 3 && piece >= 0; py++) {
+        for (int px = 0; px < tetrominoWidth; px++) {
+            if (pieceMasks[piece][1] & (1 << (py * tetrominoWidth + px))) {
+                mvaddch(y + py - 1, x + px, "ABCDEFG"[piece]);
+            }
+        }
+    }
+}
+
+/**
+ * Printing game field with current, held and upcoming pieces.
+ *
+ * @param top, left Screen coordinates of top left corner of field.
+ */
+void printGame(const Game &game, int top, int left) {
+
+    // Filling screen with field.
+    for (int x = 0; x < fieldWidth; x++) {
+        for (int y = 0; y < fieldHeight; y++) {
+            screen[y * fieldWidth + x] =
+                " ABCDEFG=#"[game.board.field[y * fieldWidth + x]];
+        }
+    }
+
+    // Filling screen with piece.
     for (int x = 0; x < tetrominoWidth; x++) {
         for (int y = 0; y < tetrominoWidth; y++) {
 
-            // Index of rotated pixel.
-            int pi = rotate(x, y, r);
+            int px = game.currentX + x;
+            int py = game.currentY + y;
 
-            // Index of pixel in field.
-            int fi = ((posY + y) * fieldWidth) + (posX + x);
+            if (tetromino[game.currentPiece]
+                         [rotate(x, y, game.currentRotation)] == 'X' &&
+                px >= 0 && px < fieldWidth && py >= 0 && py < fieldHeight) {
+                screen[py * fieldWidth + px] = "ABCDEFG"[game.currentPiece];
+            }
+        }
+    }
 
-            if (posX + x >= 0 && posX + x < fieldWidth) {
-                if (posY + y >= 0 && posY + y < fieldHeight) {
+    printScreen(screen, top, left);
 
-                    // If tetromino has piece on current pixel
-                    // and current pixel on field is not empty
-                    // then piece does not fits.
-                    if (tetromino[tetrominoIndex][pi] == 'X' &&
-                        field[fi] != 0) {
-                        return false;
-                    }
-                }
-            }
+    // Printing hold and upcoming pieces around the field.
+    mvprintw(top, left - 6, "Hold");
+    printPiece(top + 1, left - 6, game.holdPiece);
+    mvprintw(top, left + fieldWidth + 2, "Next");
+    for (int i = 0; i < game.options.previewDepth; i++) {
+        printPiece(top + 1 + 3 * i, left + fieldWidth + 2,
+                   peekPiece(game.queue, i));
+    }
+}
+
+/**
+ * Getting bytes written by process, which are all terminal output
+ * as ncurses doesn't report how much it writes.
+ *
+ * @return Bytes written, 0 if system doesn't tell.
+ */
+uint64_t writtenBytes() {
+
+    unsigned long long bytes = 0;
+    FILE *file = fopen("/proc/self/io", "r");
+    if (file) {
+        if (fscanf(file, "rchar: %*u wchar: %llu", &bytes) != 1) {
+            bytes = 0;
         }
+        fclose(file);
     }
+    return bytes;
+}
 
-    return true;
+/**
+ * Printing counters, per frame ones as change since previous frame.
+ *
+ * @param y, x Screen coordinates of top left corner.
+ */
+void printStats(int y, int x, const uint64_t totals[counterCount],
+                const uint64_t previous[counterCount]) {
+
+    mvprintw(y, x, "Checks: %llu",
+             (unsigned long long)(totals[counterCollisionChecks] -
+                                  previous[counterCollisionChecks]));
+    mvprintw(y + 1, x, "Cells: %llu",
+             (unsigned long long)(totals[counterCellsWritten] -
+                                  previous[counterCellsWritten]));
+    mvprintw(y + 2, x, "Bytes: %llu",
+             (unsigned long long)(totals[counterBytesEmitted] -
+                                  previous[counterBytesEmitted]));
+    mvprintw(y + 3, x, "Overruns: %llu",
+             (unsigned long long)totals[counterTickOverruns]);
+    mvprintw(y + 4, x, "Inputs: %llu",
+             (unsigned long long)totals[counterInputEvents]);
+}
+
+/**
+ * Waiting until key is pressed or timeout passes.
+ *
+ * @param timeout Microseconds to wait.
+ */
+void waitForInput(int64_t timeout) {
+
+    if (timeout <= 0) {
+        return;
+    }
+
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(STDIN_FILENO, &fds);
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000000;
+    tv.tv_usec = timeout % 1000000;
+
+    select(STDIN_FILENO + 1, &fds, NULL, NULL, &tv);
 }
 
+// File for phase trace, written on exit and on SIGUSR1.
+const char *tracePath = NULL;
+volatile sig_atomic_t isTraceRequested = 0;
+
+// Signal which interrupted game, 0 while it runs.
+volatile sig_atomic_t interruptingSignal = 0;
+
+// Showing counters next to game and printing them on exit.
+bool showStats = false;
 
+// Times of game cycle, printed on exit and written to file if asked.
+Histogram tickTimes;
+Histogram renderTimes;
+Histogram inputLatencies;
+const char *histogramPath = NULL;
 
 /**
- * Printing game field in the center of the screen.
+ * Printing summary of game cycle times and
+ * writing whole histograms to file.
  */
-void printScreen(char screen[]) {
+void reportTimes() {
 
-    for (int i = 0; i < fieldArea; i++) {
-        if (i % (fieldWidth) == 0) {
-            mvaddch(i / (fieldWidth) + (row / 2 - fieldHeight / 2),
-                    i % (fieldWidth) + (col / 2 - fieldWidth / 2), '\n');
-        }
-        mvaddch(i / (fieldWidth) + (row / 2 - fieldHeight / 2),
-                i % (fieldWidth) + (col / 2 - fieldWidth / 2), screen[i]);
+    printHistogram(stdout, "Tick time", tickTimes);
+    printHistogram(stdout, "Render time", renderTimes);
+    printHistogram(stdout, "Input latency", inputLatencies);
+
+    if (!histogramPath) {
+        return;
     }
+    FILE *file = fopen(histogramPath, "w");
+    if (!file) {
+        perror("Can't write histograms");
+        return;
+    }
+    writeHistogram(file, "Tick time", tickTimes);
+    writeHistogram(file, "Render time", renderTimes);
+    writeHistogram(file, "Input latency", inputLatencies);
+    fclose(file);
 }
 
 /**
- * Exiting ncurses before exiting program
- * so terminal doesn't broke.
+ * Asking game cycle to stop, so ncurses is ended and
+ * reports are written outside of signal handler.
  */
 void interruptionHandler(int signal) {
-    endwin();
-    printf("Caught signal %d, exiting...\n", signal);
-    exit(1);
+    interruptingSignal = signal;
 }
 
-int main() {
+/**
+ * Asking game cycle to write trace, as writing
+ * isn't safe inside signal handler.
+ */
+void traceRequestHandler(int signal) {
+    isTraceRequested = 1;
+}
+
+/**
+ * Printing options, for unknown option or invalid value.
+ */
+void printUsage(const char *program) {
+    printf("Usage: %s [--srs] [--spins=t|all]\n"
+           "    [--rules=project|nes|guideline] [--seed=N] [--bag]\n"
+           "    [--preview=1-6] [--das=MS] [--arr=MS] [--lock-delay=MS]\n"
+           "    [--20g] [--versus=2-4] [--trace=FILE] [--stats]\n"
+           "    [--histograms=FILE]\n",
+           program);
+}
+
+/**
+ * Parsing time option given in milliseconds.
+ *
+ * @param time Output time in microseconds.
+ * @return False if negative or too long.
+ */
+bool parseMillis(const char *text, int &time) {
+
+    int millis = atoi(text);
+    if (millis < 0 || millis > INT_MAX / 1000) {
+        return false;
+    }
+    time = millis * 1000;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    GameOptions gameOptions;
+    gameOptions.seed = time(NULL);
+    int players = 1;
+
+    static struct option options[] = {{"srs", no_argument, NULL, 's'},
+                                      {"spins", required_argument, NULL, 't'},
+                                      {"rules", required_argument, NULL, 'r'},
+                                      {"seed", required_argument, NULL, 'e'},
+                                      {"bag", no_argument, NULL, 'b'},
+                                      {"preview", required_argument, NULL, 'p'},
+                                      {"das", required_argument, NULL, 'D'},
+                                      {"arr", required_argument, NULL, 'A'},
+                                      {"lock-delay", required_argument, NULL, 'L'},
+                                      {"20g", no_argument, NULL, 'G'},
+                                      {"versus", required_argument, NULL, 'V'},
+                                      {"trace", required_argument, NULL, 'T'},
+                                      {"stats", no_argument, NULL, 'S'},
+                                      {"histograms", required_argument, NULL, 'H'},
+                                      {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "st:r:e:bp:D:A:L:GV:T:SH:", options, NULL)) != -1) {
+        switch (option) {
+        case 's':
+            gameOptions.useSrs = true;
+            break;
+        case 't':
+            if (strcmp(optarg, "t") == 0) {
+                gameOptions.spinMode = spinModeT;
+            } else if (strcmp(optarg, "all") == 0) {
+                gameOptions.spinMode = spinModeAll;
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'r':
+            gameOptions.ruleset = findRuleset(optarg);
+            if (gameOptions.ruleset < 0) {
+                printf("Unknown rules: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'e':
+            gameOptions.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'b':
+            gameOptions.useBag = true;
+            break;
+        case 'p':
+            gameOptions.previewDepth = atoi(optarg);
+            if (gameOptions.previewDepth < 1 ||
+                gameOptions.previewDepth > maxPreviewDepth) {
+                printf("Preview must be from 1 to %d\n", maxPreviewDepth);
+                return 1;
+            }
+            break;
+        case 'D':
+            if (!parseMillis(optarg, gameOptions.dasTime)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'A':
+            if (!parseMillis(optarg, gameOptions.arrTime)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'L':
+            if (!parseMillis(optarg, gameOptions.lockDelay)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'G':
+            gameOptions.gravity20G = true;
+            break;
+        case 'V':
+            players = atoi(optarg);
+            if (players < 2 || players > maxPlayers) {
+                printf("Versus needs from 2 to %d players\n", maxPlayers);
+                return 1;
+            }
+            break;
+        case 'T':
+            tracePath = optarg;
+            break;
+        case 'S':
+            showStats = true;
+            break;
+        case 'H':
+            histogramPath = optarg;
+            break;
+        default:
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
 
     // Attaching interruption handler.
     struct sigaction sigIntHandler;
@@ -108,37 +378,31 @@ int main() {
     sigemptyset(&sigIntHandler.sa_mask);
     sigIntHandler.sa_flags = 0;
     sigaction(SIGINT, &sigIntHandler, NULL);
-
-    // Filling tetromino array.
-    /* string *tetromino = prepareTetromino(); */
-
-    // Filling play field.
-    for (int x = 0; x < fieldWidth; x++) {
-        for (int y = 0; y < fieldHeight; y++) {
-            field[y * fieldWidth + x] =
-                (x == 0 || x == fieldWidth - 1 || y == fieldHeight - 1) ? 9 : 0;
-        }
-    }
+    struct sigaction sigUsr1Handler = sigIntHandler;
+    sigUsr1Handler.sa_handler = traceRequestHandler;
+    sigaction(SIGUSR1, &sigUsr1Handler, NULL);
 
     // Game logic.
-    bool isGameOver = false;
-    int currentPiece = 2;
-    int currentRotation = 0;
-    int currentX = fieldWidth / 2;
-    int currentY = 0;
+    Match match;
+    initMatch(match, players, gameOptions);
     int pressedKey = 0;
 
-    // Game speed.
-    int tickTime = 25; // ms.
-    int speed = 20;
-    int speedCounter = 0;
-    bool forceDown = false;
-    int pieceCount = 0;
-    int score = 0;
-    int level = 0;
-
-    // Storing completed row.
-    vector<int> lines;
+    // Terminals don't report key release, so held key is
+    // released once it stops repeating.
+    int64_t keyReleaseTime = 50000; // us.
+    int heldKey[maxPlayers] = {-1, -1, -1, -1};
+    int64_t heldKeyTime[maxPlayers] = {0, 0, 0, 0};
+    int64_t startTime = nowMicros();
+
+    // Cycle is overrun when it wakes this late for game event.
+    int64_t overrunTime = 1000; // us.
+    registerCounters();
+    uint64_t totals[counterCount] = {};
+    uint64_t previous[counterCount] = {};
+    uint64_t bytes = writtenBytes();
+    initHistogram(tickTimes);
+    initHistogram(renderTimes);
+    initHistogram(inputLatencies);
 
     // Ncurses initialization.
     initscr();
@@ -151,168 +415,166 @@ int main() {
     clear();
 
     // Game cycle.
-    while (!isGameOver) {
+    while (!interruptingSignal && playersLeft(match) > (players > 1 ? 1 : 0)) {
+
+        TRACE_SCOPE("frame");
+        if (isTraceRequested && tracePath) {
+            isTraceRequested = 0;
+            writeTrace(tracePath);
+        }
 
         // ========== GAME TIMING ==========
 
-        usleep(tickTime * 1000);
+        TRACE_PHASE("game timing");
 
-        speedCounter++;
-        forceDown = (speedCounter == speed);
+        // Sleeping until next game event or key press.
+        int64_t deadline = INT64_MAX;
+        for (int i = 0; i < players; i++) {
+            if (!match.games[i].isGameOver &&
+                nextEventTime(match.games[i]) < deadline) {
+                deadline = nextEventTime(match.games[i]);
+            }
+            if (heldKey[i] >= 0 && heldKeyTime[i] + keyReleaseTime < deadline) {
+                deadline = heldKeyTime[i] + keyReleaseTime;
+            }
+        }
+        waitForInput(deadline - (nowMicros() - startTime));
 
         // ========== INPUT ================
 
-        pressedKey = getch();
-        clear();
+        TRACE_PHASE("input");
 
-        // ========== GAME LOGIC ===========
+        // Key press time is when waiting noticed it, as
+        // terminal doesn't tell when key was pressed.
+        int64_t wakeTime = nowMicros();
+        int64_t now = wakeTime - startTime;
+        int keysRead = 0;
+        countEvent(counterTicks);
+        if (deadline != INT64_MAX && now - deadline >= overrunTime) {
+            countEvent(counterTickOverruns);
+        }
+        for (int i = 0; i < players; i++) {
+            if (heldKey[i] >= 0 && now >= heldKeyTime[i] + keyReleaseTime) {
+                releaseKey(match.games[i], heldKey[i],
+                           heldKeyTime[i] + keyReleaseTime);
+                heldKey[i] = -1;
+            }
+        }
 
-        // Handling movement.
-        currentX -= ((pressedKey == 104 || pressedKey == 97) &&
-                     doesPieceFit(currentPiece, currentRotation, currentX - 1,
-                                  currentY))
-                        ? 1
-                        : 0;
-        currentX += ((pressedKey == 108 || pressedKey == 100) &&
-                     doesPieceFit(currentPiece, currentRotation, currentX + 1,
-                                  currentY))
-                        ? 1
-                        : 0;
-        currentY += ((pressedKey == 106 || pressedKey == 115) &&
-                     doesPieceFit(currentPiece, currentRotation, currentX,
-                                  currentY + 1))
-                        ? 1
-                        : 0;
-        currentRotation +=
-            ((pressedKey == 107 || pressedKey == 119 || pressedKey == 32) &&
-             doesPieceFit(currentPiece, currentRotation + 1, currentX,
-                          currentY))
-                ? 1
-                : 0;
-
-        // Handling game.
-        if (forceDown) {
-            if (doesPieceFit(currentPiece, currentRotation, currentX,
-                             currentY + 1)) {
-                currentY++;
+        // Every key is applied at the time it was read.
+        while ((pressedKey = getch()) != ERR) {
+            int player;
+            int key = keyFromChar(pressedKey, player);
+            if (key < 0) {
+                continue;
+            }
+            if (players == 1) {
+                player = 0;
+            } else if (player >= players) {
+                continue;
             }
 
-            else {
-
-                // Lock current piece in field.
-                for (int x = 0; x < tetrominoWidth; x++) {
-                    for (int y = 0; y < tetrominoWidth; y++) {
-                        if (tetromino[currentPiece]
-                                     [rotate(x, y, currentRotation)] == 'X') {
-                            field[(currentY + y) * fieldWidth +
-                                  (currentX + x)] = currentPiece + 1;
-                        }
-                    }
-                }
-
-                // Increase piece number.
-                pieceCount++;
-                if (pieceCount % 10 == 0) {
-                    if (speed > 5) {
-                        level += 1;
-                        speed -= 5;
-                    }
-                }
-
-                // Check if we got any lines.
-                for (int y = 0; y < tetrominoWidth; y++) {
-                    if (currentY + y < fieldHeight - 1) {
-
-                        bool line = true;
-                        for (int x = 1; x < fieldWidth - 1; x++) {
-                            line &=
-                                (field[(currentY + y) * fieldWidth + x]) != 0;
-                        }
-
-                        if (line) {
-
-                            /* // Set line to '='. */
-                            /* for (int x = 1; x < fieldWidth - 1; x++) { */
-                            /*     field[(currentY + y) * fieldWidth + x] = 8;
-                             */
-                            /* } */
-
-                            lines.push_back(currentY + y);
-                        }
-                    }
-                }
-
-                // Increasing score.
-                score += 25;
-                if (!lines.empty()) {
-                    score += power(lines.size(), 2) * 100;
-                }
-
-                // Removing line.
-                if (!lines.empty()) {
-
-                    /* usleep(1000 * 1000); */
-
-                    for (int v : lines) {
-                        for (int x = 1; x < fieldWidth - 1; x++) {
-                            for (int y = v; y > 0; y--) {
-                                field[y * fieldWidth + x] =
-                                    field[(y - 1) * fieldWidth + x];
-                            }
-                            field[x] = 0;
-                        }
-                    }
-                    lines.clear();
-                }
-
-                // Choose next piece.
-                currentX = fieldWidth / 2;
-                currentY = 0;
-                currentRotation = 0;
-                srand(time(NULL));
-                currentPiece = rand() % 7;
-
-                // Exit if piece does not fit.
-                isGameOver = !doesPieceFit(currentPiece, currentRotation,
-                                           currentX, currentY + 1);
+            Game &game = match.games[player];
+            now = nowMicros() - startTime;
+            if (key <= keyDown && heldKey[player] >= 0 &&
+                heldKey[player] != key) {
+                releaseKey(game, heldKey[player], now);
             }
+            pressKey(game, key, now);
+            countEvent(counterInputEvents);
+            keysRead++;
+            if (key <= keyDown) {
+                heldKey[player] = key;
+                heldKeyTime[player] = now;
+            }
+        }
 
-            speedCounter = 0;
+        // ========== GAME LOGIC ===========
+
+        TRACE_PHASE("game logic");
+
+        now = nowMicros() - startTime;
+        for (int i = 0; i < players; i++) {
+            advanceGame(match.games[i], now);
+            sendGarbage(match, i);
         }
+        for (int i = 0; i < players; i++) {
+            receiveGarbage(match, i);
+        }
+        clear();
 
         // ========== RENDER OUTPUT ========
 
-        // Filling screen with field.
-        for (int x = 0; x < fieldWidth; x++) {
-            for (int y = 0; y < fieldHeight; y++) {
-                screen[y * fieldWidth + x] =
-                    " ABCDEFG=#"[field[y * fieldWidth + x]];
+        TRACE_PHASE("render output");
+
+        int64_t renderTime = nowMicros();
+
+        if (players == 1) {
+            Game &game = match.games[0];
+            printGame(game, row / 2 - fieldHeight / 2, col / 2 - fieldWidth / 2);
+            mvprintw(row / 2 - 2, 3 * col / 4 - 3, "Score: %d", game.score);
+            mvprintw(row / 2 - 1, 3 * col / 4 - 3, "Pieces: %d",
+                     game.pieceCount);
+            mvprintw(row / 2, 3 * col / 4 - 3, "Level: %d", game.level);
+        } else {
+            for (int i = 0; i < players; i++) {
+                int top = row / 2 - fieldHeight / 2;
+                int left = col * (2 * i + 1) / (2 * players) - fieldWidth / 2;
+                printGame(match.games[i], top, left);
+                mvprintw(top + fieldHeight + 1, left, "Score: %d",
+                         match.games[i].score);
             }
         }
-
-        // Filling screen with piece.
-        for (int x = 0; x < tetrominoWidth; x++) {
-            for (int y = 0; y < tetrominoWidth; y++) {
-
-                if (tetromino[currentPiece][rotate(x, y, currentRotation)] ==
-                    'X') {
-                    screen[(currentY + y) * fieldWidth + (currentX + x)] =
-                        "ABCDEFG"[currentPiece];
-                }
+        if (showStats) {
+            uint64_t written = writtenBytes();
+            countEvent(counterBytesEmitted, written - bytes);
+            bytes = written;
+            memcpy(previous, totals, sizeof(totals));
+            sumCounters(totals);
+            if (players == 1) {
+                printStats(row / 2 + 2, 3 * col / 4 - 3, totals, previous);
+            } else {
+                printStats(0, 0, totals, previous);
             }
         }
-
-        // Printing screen.
-        printScreen(screen);
-        mvprintw(row / 2 - 2, 3 * col / 4 - 3, "Score: %d", score);
-        mvprintw(row / 2 - 1, 3 * col / 4 - 3, "Pieces: %d", pieceCount);
-        mvprintw(row / 2, 3 * col / 4 - 3, "Level: %d", level);
         /* mvprintw(row - 1, col / 2, "%d", pressedKey); */
+
+        // Flushing now, otherwise getch() does it after next wait.
+        refresh();
+        int64_t flushTime = nowMicros();
+        recordValue(renderTimes, flushTime - renderTime);
+        recordValue(tickTimes, flushTime - wakeTime);
+        for (int i = 0; i < keysRead; i++) {
+            recordValue(inputLatencies, flushTime - wakeTime);
+        }
+        TRACE_PHASE(NULL);
     }
 
     endwin();
+    if (tracePath && !writeTrace(tracePath)) {
+        perror("Can't write trace");
+    }
 
-    printf("You lost!\nScore: %d", score);
+    if (interruptingSignal) {
+        printf("Caught signal %d, exiting...\n", (int)interruptingSignal);
+    } else if (players == 1) {
+        printf("You lost!\nScore: %d\n", match.games[0].score);
+    } else {
+        int winner = matchWinner(match);
+        if (winner >= 0) {
+            printf("Player %d wins!\n", winner + 1);
+        } else {
+            printf("Draw!\n");
+        }
+        for (int i = 0; i < players; i++) {
+            printf("Player %d score: %d\n", i + 1, match.games[i].score);
+        }
+    }
+    reportTimes();
+    if (showStats) {
+        sumCounters(totals);
+        printCounters(totals);
+    }
 
-    return 0;
+    return interruptingSignal ? 1 : 0;
 }
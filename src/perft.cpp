@@ -0,0 +1,153 @@
+/*
+ * Counting placement sequences, as perft does for chess moves.
+ *
+ * Counts for every depth up to given one are printed with time
+ * taken, so the same command checks move generation and
+ * measures its speed.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <thread>
+#include <vector>
+#include "../include/placement.h"
+#include "../include/scheduler.h"
+
+// Tetromino letters in index order.
+const char pieceLetters[] = "ITOZSLJ";
+
+/**
+ * Counting of one depth, split by first placement.
+ */
+struct PerftRun {
+    Board board;
+    std::vector<int> pieces;
+    int depth;
+    Placement placements[maxPlacements];
+    uint64_t counts[maxPlacements];
+};
+
+/**
+ * Counting sequences starting with one placement.
+ */
+static void countPlacement(int index, int worker, void *context) {
+
+    PerftRun &run = *(PerftRun *)context;
+    const Placement &first = run.placements[index];
+    Board next = run.board;
+    lockPiece(next, run.pieces[0], first.r, first.x, first.y);
+
+    int lines[tetrominoWidth];
+    int lineCount = findLines(next, first.y, lines);
+    removeLines(next, lines, lineCount);
+
+    run.counts[index] = perft(next, run.pieces.data() + 1, run.depth - 1);
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    int depth = 4;
+    const char *letters = pieceLetters;
+    int garbage = 0;
+    int threadCount = std::thread::hardware_concurrency();
+    bool isDivided = false;
+
+    static struct option options[] = {
+        {"depth", required_argument, NULL, 'd'},
+        {"pieces", required_argument, NULL, 'p'},
+        {"garbage", required_argument, NULL, 'g'},
+        {"threads", required_argument, NULL, 'j'},
+        {"divide", no_argument, NULL, 'D'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "d:p:g:j:D", options, NULL)) !=
+           -1) {
+        switch (option) {
+        case 'd':
+            depth = atoi(optarg);
+            break;
+        case 'p':
+            letters = optarg;
+            break;
+        case 'g':
+            garbage = atoi(optarg);
+            break;
+        case 'j':
+            threadCount = atoi(optarg);
+            break;
+        case 'D':
+            isDivided = true;
+            break;
+        default:
+            printf("Usage: %s [--depth=N] [--pieces=ITOZSLJ] [--garbage=ROWS]\n"
+                   "    [--threads=N] [--divide]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+
+    // Pieces repeat when there are fewer of them than depth.
+    PerftRun run;
+    int letterCount = strlen(letters);
+    for (int i = 0; i < depth && letterCount > 0; i++) {
+        const char *letter = strchr(pieceLetters, letters[i % letterCount]);
+        if (!letter || !*letter) {
+            printf("Unknown piece: %c\n", letters[i % letterCount]);
+            return 1;
+        }
+        run.pieces.push_back(letter - pieceLetters);
+    }
+    if (depth < 1 || letterCount == 0) {
+        printf("Depth and pieces must not be empty\n");
+        return 1;
+    }
+    if (garbage < 0 || garbage >= fieldHeight - 1) {
+        printf("Garbage must be from 0 to %d rows\n", fieldHeight - 2);
+        return 1;
+    }
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+
+    // Garbage holes are spread, so lines can be cleared.
+    initBoard(run.board);
+    for (int i = 0; i < garbage; i++) {
+        insertGarbage(run.board, 1, 1 + i * 7 % (fieldWidth - 2));
+    }
+
+    for (int d = 1; d <= depth; d++) {
+        std::chrono::steady_clock::time_point start =
+            std::chrono::steady_clock::now();
+        run.depth = d;
+        int count = findPlacements(run.board, run.pieces[0], run.placements);
+        uint64_t total = count;
+        if (d > 1) {
+            runJobs(count, threadCount, countPlacement, &run);
+            total = 0;
+            for (int i = 0; i < count; i++) {
+                total += run.counts[i];
+            }
+        }
+        double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+        printf("perft(%d) = %llu in %.3f s, %.0f sequences/s\n", d,
+               (unsigned long long)total, seconds,
+               seconds > 0 ? total / seconds : 0);
+
+        // Dividing helps to find which branch differs.
+        if (isDivided && d == depth) {
+            for (int i = 0; i < count; i++) {
+                printf("  r%d x%d y%d: %llu\n", run.placements[i].r,
+                       run.placements[i].x, run.placements[i].y,
+                       (unsigned long long)(d > 1 ? run.counts[i] : 1));
+            }
+        }
+    }
+
+    return 0;
+}
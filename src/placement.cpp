@@ -0,0 +1,105 @@
+#include "../include/placement.h"
+
+/**
+ * Finding all distinct positions tetromino can be dropped to.
+ *
+ * Tetromino is rotated and moved at the top row and dropped
+ * straight down. Rotations covering the same cells (as all
+ * rotations of O do) are counted once.
+ *
+ * @param board Board to drop tetromino on.
+ * @param tetrominoIndex Tetromino index (0-6).
+ * @param placements Output placements.
+ * @return Number of placements.
+ */
+int findPlacements(const Board &board, int tetrominoIndex,
+                   Placement placements[maxPlacements]) {
+
+    int count = 0;
+    uint64_t cells[maxPlacements];
+
+    for (int r = 0; r < rotationCount; r++) {
+        uint16_t mask = pieceMasks[tetrominoIndex][r];
+
+        for (int x = 1 - tetrominoWidth; x < fieldWidth; x++) {
+
+            // Every pixel must be inside the field.
+            int inside = 0;
+            for (int y = 0; y < tetrominoWidth; y++) {
+                inside += __builtin_popcount(pieceRow(mask, y, x));
+            }
+            if (inside != tetrominoWidth ||
+                !pieceFits(board, tetrominoIndex, r, x, 0)) {
+                continue;
+            }
+
+            int y = dropDistance(board, tetrominoIndex, r, x, 0);
+
+            // Covered cells as field rows, starting from first pixel row.
+            int top = __builtin_ctz(mask) / tetrominoWidth;
+            uint64_t key = (uint64_t)(y + top) << 48;
+            for (int py = top; py < tetrominoWidth; py++) {
+                key |= (uint64_t)pieceRow(mask, py, x)
+                       << (fieldWidth * (py - top));
+            }
+
+            bool seen = false;
+            for (int i = 0; i < count && !seen; i++) {
+                seen = cells[i] == key;
+            }
+            if (seen) {
+                continue;
+            }
+
+            cells[count] = key;
+            placements[count].r = r;
+            placements[count].x = x;
+            placements[count].y = y;
+            count++;
+        }
+    }
+
+    return count;
+}
+
+/**
+ * Counting placement sequences, as chess engines count move
+ * sequences, to test and benchmark move generation.
+ *
+ * Every placement is locked and its lines are cleared before
+ * the next piece is placed.
+ *
+ * @param board Starting board.
+ * @param pieces Tetromino indices (0-6), one per depth.
+ * @param depth Number of pieces to place.
+ * @return Number of distinct placement sequences.
+ */
+uint64_t perft(const Board &board, const int pieces[], int depth) {
+
+    if (depth == 0) {
+        return 1;
+    }
+
+    Placement placements[maxPlacements];
+    int count = findPlacements(board, pieces[0], placements);
+
+    // Last level only needs the count.
+    if (depth == 1) {
+        return count;
+    }
+
+    uint64_t total = 0;
+    for (int i = 0; i < count; i++) {
+        Board next = board;
+        lockPiece(next, pieces[0], placements[i].r, placements[i].x,
+                  placements[i].y);
+
+        int lines[tetrominoWidth];
+        int lineCount = findLines(next, placements[i].y, lines);
+        removeLines(next, lines, lineCount);
+
+        total += perft(next, pieces + 1, depth - 1);
+    }
+
+    return total;
+}
@@ -0,0 +1,58 @@
+#include "../include/functions.h"
+#include "../include/preview.h"
+
+/**
+ * Adding batch of pieces to the end of queue.
+ */
+static void refillQueue(PieceQueue &queue) {
+
+    char batch[tetrominoCount];
+
+    for (int i = 0; i < tetrominoCount; i++) {
+        batch[i] = queue.useBag ? i : randomBelow(queue.random, tetrominoCount);
+    }
+
+    // Fisher-Yates shuffle of the bag.
+    for (int i = tetrominoCount - 1; queue.useBag && i > 0; i--) {
+        int j = randomBelow(queue.random, i + 1);
+        char tmp = batch[i];
+        batch[i] = batch[j];
+        batch[j] = tmp;
+    }
+
+    for (int i = 0; i < tetrominoCount; i++) {
+        queue.pieces[queue.tail++ % pieceQueueSize] = batch[i];
+    }
+}
+
+/**
+ * Filling queue from seed.
+ *
+ * @param seed Randomizer seed, same seed gives same pieces.
+ * @param useBag Use 7-bag randomizer instead of independent pieces.
+ */
+void initQueue(PieceQueue &queue, uint64_t seed, bool useBag) {
+
+    queue.head = 0;
+    queue.tail = 0;
+    queue.random = seed ^ 0x9E3779B97F4A7C15ULL;
+    queue.useBag = useBag;
+
+    refillQueue(queue);
+}
+
+/**
+ * Taking next piece from queue.
+ *
+ * @return Tetromino index (0-6).
+ */
+int popPiece(PieceQueue &queue) {
+
+    int piece = queue.pieces[queue.head++ % pieceQueueSize];
+
+    if (queue.tail - queue.head < (unsigned int)maxPreviewDepth) {
+        refillQueue(queue);
+    }
+
+    return piece;
+}
@@ -0,0 +1,337 @@
+/*
+ * End-to-end benchmark of terminal game.
+ *
+ * Runs bin/tetris under pseudo-terminal, types scripted keys at
+ * given times and splits its output into frames the way terminal
+ * would show them, measuring frame rate, bytes per frame and
+ * latency from typing key to frame drawn after it.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <poll.h>
+#include <pty.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "../include/histogram.h"
+#include "../include/terminal.h"
+
+// Output arriving this soon after previous output belongs to the
+// same frame. Game flushes every frame with one write, so only
+// frames closer than this are merged.
+const int64_t frameGap = 1000; // us.
+
+/**
+ * Keys typed at once.
+ */
+struct ScriptedKeys {
+    int64_t time; // Microseconds since start.
+    std::string keys;
+};
+
+/**
+ * Output of game split into frames.
+ */
+struct PtyBench {
+    int escapeState; // 0: text, 1: after ESC, 2: inside CSI sequence.
+    bool isFrameOpen;
+    int64_t frameStart;
+    int64_t lastOutput;
+    int64_t frameBytes;
+    int64_t frameCells;
+    int64_t frameSequences;
+    int frames;
+    int64_t bytes;
+    std::vector<int64_t> typedTimes; // Keys waiting for frame.
+    Histogram bytesPerFrame;
+    Histogram cellsPerFrame;
+    Histogram sequencesPerFrame;
+    Histogram inputLatencies;
+    std::string tail; // Output after the last frame.
+};
+
+/**
+ * Counting characters and escape sequences of output.
+ */
+static void parseOutput(PtyBench &bench, const char *data, ssize_t size) {
+
+    for (ssize_t i = 0; i < size; i++) {
+        unsigned char c = data[i];
+        if (bench.escapeState == 1) {
+            bench.escapeState = c == '[' ? 2 : 0;
+            if (c != '[') {
+                bench.frameSequences++;
+            }
+        } else if (bench.escapeState == 2) {
+            // Parameters and intermediate bytes come before final byte.
+            if (c >= 0x40 && c <= 0x7E) {
+                bench.escapeState = 0;
+                bench.frameSequences++;
+            }
+        } else if (c == 0x1B) {
+            bench.escapeState = 1;
+        } else if (c >= 0x20) {
+            bench.frameCells++;
+        }
+    }
+    bench.frameBytes += size;
+    bench.bytes += size;
+}
+
+/**
+ * Ending frame, keys typed before it started get their latency.
+ */
+static void closeFrame(PtyBench &bench) {
+
+    recordValue(bench.bytesPerFrame, bench.frameBytes);
+    recordValue(bench.cellsPerFrame, bench.frameCells);
+    recordValue(bench.sequencesPerFrame, bench.frameSequences);
+    bench.frames++;
+
+    size_t answered = 0;
+    while (answered < bench.typedTimes.size() &&
+           bench.typedTimes[answered] <= bench.frameStart) {
+        recordValue(bench.inputLatencies,
+                    bench.lastOutput - bench.typedTimes[answered]);
+        answered++;
+    }
+    bench.typedTimes.erase(bench.typedTimes.begin(),
+                           bench.typedTimes.begin() + answered);
+    bench.isFrameOpen = false;
+}
+
+/**
+ * Reading script, every line is "MS KEYS".
+ *
+ * @return False if file can't be read.
+ */
+static bool readScript(const char *path, std::vector<ScriptedKeys> &script) {
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    long long time;
+    char keys[256];
+    while (fscanf(file, "%lld %255s", &time, keys) == 2) {
+        ScriptedKeys line = {time * 1000, keys};
+        script.push_back(line);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * Printing percentiles of histogram not measured in time.
+ */
+static void printCounts(const char *name, const Histogram &values) {
+    printf("%s: p50 %lld, p99 %lld, max %lld\n", name,
+           (long long)valuePercentile(values, 50),
+           (long long)valuePercentile(values, 99), (long long)values.max);
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options, the rest is passed to game.
+    const char *game = "bin/tetris";
+    int64_t duration = 5000000;
+    std::string keys = "adwq";
+    int64_t interval = 50000;
+    const char *scriptPath = NULL;
+    int64_t maxLatency = 0;
+    int64_t maxBytes = 0;
+
+    static struct option options[] = {{"game", required_argument, NULL, 'g'},
+                                      {"duration", required_argument, NULL, 'd'},
+                                      {"keys", required_argument, NULL, 'k'},
+                                      {"interval", required_argument, NULL, 'i'},
+                                      {"script", required_argument, NULL, 's'},
+                                      {"max-latency", required_argument, NULL, 'l'},
+                                      {"max-bytes", required_argument, NULL, 'b'},
+                                      {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "g:d:k:i:s:l:b:", options, NULL)) != -1) {
+        switch (option) {
+        case 'g':
+            game = optarg;
+            break;
+        case 'd':
+            duration = atoll(optarg) * 1000;
+            break;
+        case 'k':
+            keys = optarg;
+            break;
+        case 'i':
+            interval = atoll(optarg) * 1000;
+            break;
+        case 's':
+            scriptPath = optarg;
+            break;
+        case 'l':
+            maxLatency = atoll(optarg);
+            break;
+        case 'b':
+            maxBytes = atoll(optarg);
+            break;
+        default:
+            printf("Usage: %s [--game=PATH] [--duration=MS] [--keys=KEYS]\n"
+                   "    [--interval=MS] [--script=FILE] [--max-latency=US]\n"
+                   "    [--max-bytes=N] [-- GAME OPTIONS]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+
+    // Keys are typed one by one unless script says otherwise.
+    std::vector<ScriptedKeys> script;
+    if (scriptPath && !readScript(scriptPath, script)) {
+        perror("Can't read script");
+        return 1;
+    }
+    for (int64_t time = interval; !scriptPath && time < duration && !keys.empty();
+         time += interval) {
+        ScriptedKeys line = {time, std::string(1, keys[time / interval % keys.size()])};
+        script.push_back(line);
+    }
+
+    std::vector<char *> arguments;
+    arguments.push_back((char *)game);
+    std::string seed = "--seed=1";
+    if (optind == argc) {
+        arguments.push_back((char *)seed.c_str());
+    }
+    for (int i = optind; i < argc; i++) {
+        arguments.push_back(argv[i]);
+    }
+    arguments.push_back(NULL);
+
+    // Starting game on terminal of usual size.
+    winsize size = {};
+    size.ws_row = 24;
+    size.ws_col = 80;
+    int terminalFd;
+    pid_t child = forkpty(&terminalFd, NULL, NULL, &size);
+    if (child < 0) {
+        perror("forkpty");
+        return 1;
+    }
+    if (child == 0) {
+        setenv("TERM", "xterm", 1);
+        execv(game, arguments.data());
+        perror("Can't start game");
+        _exit(127);
+    }
+
+    PtyBench bench = {};
+    initHistogram(bench.bytesPerFrame);
+    initHistogram(bench.cellsPerFrame);
+    initHistogram(bench.sequencesPerFrame);
+    initHistogram(bench.inputLatencies);
+
+    int64_t startTime = nowMicros();
+    size_t nextKeys = 0;
+    bool isRunning = true;
+    bool isStopping = false;
+    char buffer[65536];
+
+    while (isRunning) {
+        int64_t now = nowMicros() - startTime;
+        if (bench.isFrameOpen && now >= bench.lastOutput + frameGap) {
+            closeFrame(bench);
+        }
+        if (!isStopping && now >= duration) {
+            // Game prints its summary on Ctrl-C.
+            kill(child, SIGINT);
+            isStopping = true;
+        }
+
+        // Reading output before typing, so output written
+        // before key isn't taken for its answer.
+        int64_t wake = isStopping ? now + 1000000 : duration;
+        if (!isStopping && nextKeys < script.size() && script[nextKeys].time < wake) {
+            wake = script[nextKeys].time;
+        }
+        if (bench.isFrameOpen && bench.lastOutput + frameGap < wake) {
+            wake = bench.lastOutput + frameGap;
+        }
+        timespec timeout;
+        int64_t wait = wake > now ? wake - now : 0;
+        timeout.tv_sec = wait / 1000000;
+        timeout.tv_nsec = wait % 1000000 * 1000;
+        pollfd event = {terminalFd, POLLIN, 0};
+        if (ppoll(&event, 1, &timeout, NULL) > 0) {
+            ssize_t count = read(terminalFd, buffer, sizeof(buffer));
+            if (count <= 0) {
+                // Terminal is closed when game exits.
+                isRunning = count < 0 && errno == EINTR;
+                continue;
+            }
+            now = nowMicros() - startTime;
+            if (isStopping) {
+                bench.tail.append(buffer, count);
+            } else {
+                if (!bench.isFrameOpen) {
+                    bench.isFrameOpen = true;
+                    bench.frameStart = now;
+                    bench.frameBytes = 0;
+                    bench.frameCells = 0;
+                    bench.frameSequences = 0;
+                }
+                bench.lastOutput = now;
+                parseOutput(bench, buffer, count);
+            }
+        }
+
+        // Typing keys which are due.
+        while (!isStopping && nextKeys < script.size() &&
+               script[nextKeys].time <= now) {
+            const std::string &typed = script[nextKeys].keys;
+            int64_t typedTime = nowMicros() - startTime;
+            if (write(terminalFd, typed.data(), typed.size()) > 0) {
+                bench.typedTimes.insert(bench.typedTimes.end(), typed.size(),
+                                        typedTime);
+            }
+            nextKeys++;
+        }
+    }
+    if (bench.isFrameOpen) {
+        closeFrame(bench);
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    close(terminalFd);
+
+    // Game summary is printed after leaving ncurses screen.
+    size_t summary = bench.tail.find("Caught signal");
+    if (summary != std::string::npos) {
+        fwrite(bench.tail.data() + summary, 1, bench.tail.size() - summary, stdout);
+    }
+    printf("Frames: %d in %.1f s, %.1f per second\n", bench.frames,
+           duration / 1e6, bench.frames * 1e6 / duration);
+    printf("Bytes: %lld\n", (long long)bench.bytes);
+    printCounts("Bytes per frame", bench.bytesPerFrame);
+    printCounts("Characters per frame", bench.cellsPerFrame);
+    printCounts("Escape sequences per frame", bench.sequencesPerFrame);
+    printHistogram(stdout, "Key to frame latency", bench.inputLatencies);
+    printf("Keys without frame: %d\n", (int)bench.typedTimes.size());
+
+    // Thresholds make benchmark fail in CI.
+    bool isPassed = bench.frames > 0;
+    if (maxLatency > 0 && valuePercentile(bench.inputLatencies, 99) > maxLatency) {
+        printf("p99 latency is above %lld us\n", (long long)maxLatency);
+        isPassed = false;
+    }
+    if (maxBytes > 0 && valuePercentile(bench.bytesPerFrame, 99) > maxBytes) {
+        printf("p99 bytes per frame is above %lld\n", (long long)maxBytes);
+        isPassed = false;
+    }
+    return isPassed ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include "../include/functions.h"
+#include "../include/rollback.h"
+#include "../include/verify.h"
+
+/**
+ * Starting versus state, seeded like initMatch().
+ */
+void initVersusState(VersusState &state, const GameOptions &options) {
+
+    for (int i = 0; i < 2; i++) {
+        initGame(state.games[i], options);
+        state.holeRandom[i] = (options.seed + i + 1) * 0x9E3779B97F4A7C15ULL;
+        state.held[i] = 0;
+    }
+    state.tick = 0;
+}
+
+/**
+ * Simulating one tick from inputs of both players.
+ *
+ * Keys pressed or released since previous tick change at the
+ * start of tick, garbage is sent at its end.
+ */
+void simulateTick(VersusState &state, const TickInput inputs[2]) {
+
+    int64_t tickTime = state.games[0].options.tickTime;
+    int64_t start = state.tick * tickTime;
+
+    for (int i = 0; i < 2; i++) {
+        Game &game = state.games[i];
+        TickInput changed = inputs[i] ^ state.held[i];
+        for (int key = 0; key < keyCount; key++) {
+            if (!(changed & (1 << key))) {
+                continue;
+            }
+            if (inputs[i] & (1 << key)) {
+                pressKey(game, key, start);
+            } else {
+                releaseKey(game, key, start);
+            }
+        }
+        advanceGame(game, start + tickTime);
+        state.held[i] = inputs[i];
+    }
+
+    for (int i = 0; i < 2; i++) {
+        Game &target = state.games[1 - i];
+        if (state.games[i].attack > 0 && !target.isGameOver) {
+            addGarbage(target, state.games[i].attack,
+                       1 + randomBelow(state.holeRandom[i], fieldWidth - 2));
+        }
+        state.games[i].attack = 0;
+    }
+
+    state.tick++;
+}
+
+/**
+ * Starting peer of rollback versus.
+ *
+ * @param local Index of player whose input is given to advanceRollback().
+ * @param options Same options, including seed, on both peers.
+ */
+void initRollback(Rollback &peer, int local, const GameOptions &options) {
+
+    peer.local = local;
+    initVersusState(peer.state, options);
+    peer.remoteTick = 0;
+    peer.lastRemote = 0;
+    peer.mispredicted = -1;
+    peer.rollbacks = 0;
+    peer.resimulatedTicks = 0;
+}
+
+/**
+ * Simulating next tick with local input and predicted remote one.
+ *
+ * @return False if peer is too far ahead of remote input and
+ * must wait, tick isn't simulated then.
+ */
+bool advanceRollback(Rollback &peer, TickInput input) {
+
+    int tick = peer.state.tick;
+    if (tick - peer.remoteTick >= rollbackWindow - 1) {
+        return false;
+    }
+
+    int slot = tick % rollbackWindow;
+    int remote = 1 - peer.local;
+    peer.snapshots[slot] = peer.state;
+    peer.inputs[peer.local][slot] = input;
+    if (tick >= peer.remoteTick) {
+        peer.inputs[remote][slot] = peer.lastRemote;
+    }
+
+    TickInput inputs[2] = {peer.inputs[0][slot], peer.inputs[1][slot]};
+    simulateTick(peer.state, inputs);
+    return true;
+}
+
+/**
+ * Storing remote input, inputs must come in tick order.
+ *
+ * Ticks already simulated with other input are resimulated
+ * by synchronizeRollback().
+ */
+void receiveRemoteInput(Rollback &peer, int tick, TickInput input) {
+
+    int slot = tick % rollbackWindow;
+    int remote = 1 - peer.local;
+
+    if (tick < peer.state.tick && peer.inputs[remote][slot] != input &&
+        (peer.mispredicted < 0 || tick < peer.mispredicted)) {
+        peer.mispredicted = tick;
+    }
+
+    peer.inputs[remote][slot] = input;
+    peer.remoteTick = tick + 1;
+    peer.lastRemote = input;
+}
+
+/**
+ * Restoring state before first misprediction and
+ * simulating again up to current tick.
+ *
+ * Ticks without remote input are predicted again
+ * from the latest one.
+ */
+void synchronizeRollback(Rollback &peer) {
+
+    int remote = 1 - peer.local;
+    int end = peer.state.tick;
+
+    for (int tick = peer.remoteTick; tick < end; tick++) {
+        int slot = tick % rollbackWindow;
+        if (peer.inputs[remote][slot] != peer.lastRemote) {
+            peer.inputs[remote][slot] = peer.lastRemote;
+            if (peer.mispredicted < 0 || tick < peer.mispredicted) {
+                peer.mispredicted = tick;
+            }
+        }
+    }
+
+    if (peer.mispredicted < 0) {
+        return;
+    }
+
+    peer.state = peer.snapshots[peer.mispredicted % rollbackWindow];
+    for (int tick = peer.mispredicted; tick < end; tick++) {
+        int slot = tick % rollbackWindow;
+        peer.snapshots[slot] = peer.state;
+        TickInput inputs[2] = {peer.inputs[0][slot], peer.inputs[1][slot]};
+        simulateTick(peer.state, inputs);
+    }
+
+    peer.rollbacks++;
+    peer.resimulatedTicks += end - peer.mispredicted;
+    peer.mispredicted = -1;
+}
+
+/**
+ * Input sent between loopback peers.
+ */
+struct InputMessage {
+    int arrival; // Tick of receiver clock.
+    int tick;
+    TickInput input;
+};
+
+/**
+ * Delivering messages which arrived by given tick and
+ * resimulating mispredicted ticks.
+ */
+static void deliverInputs(LoopbackTest &test, Rollback &peer,
+                          std::deque<InputMessage> &channel, int now) {
+
+    while (!channel.empty() && channel.front().arrival <= now) {
+        receiveRemoteInput(peer, channel.front().tick, channel.front().input);
+        channel.pop_front();
+    }
+
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    synchronizeRollback(peer);
+    test.rollbackTime += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+}
+
+/**
+ * Playing versus between two rollback peers connected
+ * by simulated network, inputs are random.
+ *
+ * Both peers must end with the same games as simulation
+ * which knows all inputs in time.
+ */
+void runLoopback(LoopbackTest &test, const GameOptions &options) {
+
+    // Random held keys, changing every few ticks.
+    uint64_t random = test.seed;
+    std::vector<TickInput> script[2];
+    for (int i = 0; i < 2; i++) {
+        TickInput held = 0;
+        for (int tick = 0; tick < test.ticks; tick++) {
+            if (randomBelow(random, 4) == 0) {
+                int key = randomBelow(random, keyCount + 2);
+                held = key < keyCount ? 1 << key : 0;
+            }
+            script[i].push_back(held);
+        }
+    }
+
+    VersusState expected;
+    initVersusState(expected, options);
+    for (int tick = 0; tick < test.ticks; tick++) {
+        TickInput inputs[2] = {script[0][tick], script[1][tick]};
+        simulateTick(expected, inputs);
+    }
+
+    std::vector<Rollback> peers(2);
+    std::deque<InputMessage> channels[2]; // To peer.
+    int lastArrival[2] = {0, 0};
+    test.stalls = 0;
+    test.rollbackTime = 0;
+
+    for (int now = 0; peers[0].state.tick < test.ticks ||
+                      peers[1].state.tick < test.ticks || now == 0;
+         now++) {
+        for (int i = 0; i < 2; i++) {
+            if (now == 0) {
+                initRollback(peers[i], i, options);
+            }
+            deliverInputs(test, peers[i], channels[i], now);
+
+            int tick = peers[i].state.tick;
+            if (tick >= test.ticks) {
+                continue;
+            }
+            if (!advanceRollback(peers[i], script[i][tick])) {
+                test.stalls++;
+                continue;
+            }
+
+            // Later message never overtakes earlier one.
+            InputMessage message;
+            message.arrival = std::max(lastArrival[1 - i],
+                                       now + test.latency +
+                                           randomBelow(random, test.jitter + 1));
+            message.tick = tick;
+            message.input = script[i][tick];
+            lastArrival[1 - i] = message.arrival;
+            channels[1 - i].push_back(message);
+        }
+    }
+
+    test.rollbacks = 0;
+    test.resimulatedTicks = 0;
+    for (int i = 0; i < 2; i++) {
+        deliverInputs(test, peers[i], channels[i], INT32_MAX);
+        test.rollbacks += peers[i].rollbacks;
+        test.resimulatedTicks += peers[i].resimulatedTicks;
+        test.expected[i] = hashGame(expected.games[i]);
+        for (int j = 0; j < 2; j++) {
+            test.hashes[i][j] = hashGame(peers[i].state.games[j]);
+        }
+    }
+}
@@ -0,0 +1,300 @@
+/*
+ * Scaling of headless bot games over threads.
+ *
+ * Every thread count plays games for the same time and is compared
+ * with one thread. Efficiency is games per second divided by thread
+ * count times games per second of one thread, so anything threads
+ * share shows as efficiency below 100%.
+ *
+ * --diagnose repeats the runs with threads counting pieces in
+ * adjacent or padded counters and with a vector allocated for every
+ * lock, as the original game loop did, so false sharing and
+ * allocator contention can be told apart.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <getopt.h>
+#include <thread>
+#include <vector>
+#include "../include/bot.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+const int maxScalingThreads = 256;
+
+// Variants of the same games.
+const int variantPrivate = 0;   // Counts kept by thread until game ends.
+const int variantAdjacent = 1;  // Counted per piece next to other threads.
+const int variantPadded = 2;    // Counted per piece on own cache line.
+const int variantAllocating = 3; // Vector of lines allocated per lock.
+const int variantCount = 4;
+const char *variantNames[variantCount] = {"private", "adjacent counters",
+                                          "padded counters", "allocating"};
+
+/**
+ * Games and pieces played by one thread.
+ */
+struct ThreadCount {
+    uint64_t games;
+    uint64_t pieces;
+    uint64_t lines; // Keeps allocating variant from being optimized out.
+    char padding[64];
+};
+
+// Counts of all threads, packed or one per cache line.
+static uint64_t adjacentPieces[maxScalingThreads];
+static ThreadCount threadCounts[maxScalingThreads];
+
+/**
+ * One measurement.
+ */
+struct ScalingRun {
+    int variant;
+    int player;
+    int maxPieces;
+    bool isPinned;
+    std::atomic<bool> isStopping;
+};
+
+/**
+ * Pinning thread to one of allowed CPUs.
+ */
+static void pinThread(int worker) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+    int cpuCount = CPU_COUNT(&allowed);
+    int skipped = cpuCount > 0 ? worker % cpuCount : 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && skipped-- == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            return;
+        }
+    }
+#endif
+}
+
+/**
+ * Playing games until run is stopped.
+ */
+static void playGames(ScalingRun *run, int worker) {
+
+    if (run->isPinned) {
+        pinThread(worker);
+    }
+
+    const Bot &player = bots[run->player];
+    uint64_t random = (worker + 1) * 0xBF58476D1CE4E5B9ULL;
+    GameOptions options;
+    options.seed = worker;
+    Game game;
+    uint64_t games = 0;
+    uint64_t pieces = 0;
+
+    while (!run->isStopping.load(std::memory_order_relaxed)) {
+        options.seed += maxScalingThreads;
+        initGame(game, options);
+
+        while (!game.isGameOver && game.pieceCount < run->maxPieces) {
+            Placement choice = player.choose(game, random);
+            if (!placePiece(game, choice.r, choice.x)) {
+                break;
+            }
+
+            // Relaxed atomic stores, so other threads may read counts.
+            if (run->variant == variantAdjacent) {
+                __atomic_store_n(&adjacentPieces[worker],
+                                 adjacentPieces[worker] + 1, __ATOMIC_RELAXED);
+            } else if (run->variant == variantPadded) {
+                __atomic_store_n(&threadCounts[worker].pieces,
+                                 threadCounts[worker].pieces + 1,
+                                 __ATOMIC_RELAXED);
+            } else if (run->variant == variantAllocating) {
+                std::vector<int> lines;
+                lines.reserve(tetrominoWidth);
+                lines.push_back(game.lastLines);
+                threadCounts[worker].lines += lines.back();
+            }
+        }
+
+        games++;
+        pieces += game.pieceCount;
+    }
+
+    threadCounts[worker].games = games;
+    if (run->variant == variantPrivate || run->variant == variantAllocating) {
+        threadCounts[worker].pieces = pieces;
+    } else if (run->variant == variantAdjacent) {
+        threadCounts[worker].pieces = adjacentPieces[worker];
+    }
+}
+
+/**
+ * Throughput of one thread count.
+ */
+struct Throughput {
+    int threadCount;
+    double games;  // Per second.
+    double pieces; // Per second.
+};
+
+/**
+ * Playing games on given number of threads for given time.
+ */
+static Throughput measure(ScalingRun &run, int threadCount, int64_t duration) {
+
+    for (int i = 0; i < threadCount; i++) {
+        adjacentPieces[i] = 0;
+        threadCounts[i].games = 0;
+        threadCounts[i].pieces = 0;
+    }
+    run.isStopping = false;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < threadCount; i++) {
+        threads.push_back(std::thread(playGames, &run, i));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+    run.isStopping = true;
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    Throughput result = {threadCount, 0, 0};
+    for (int i = 0; i < threadCount; i++) {
+        result.games += threadCounts[i].games;
+        result.pieces += threadCounts[i].pieces;
+    }
+    result.games /= seconds;
+    result.pieces /= seconds;
+    return result;
+}
+
+/**
+ * Measuring every thread count of variant and printing table.
+ *
+ * @return Efficiency at the largest thread count.
+ */
+static double measureScaling(ScalingRun &run, const std::vector<int> &threadCounts,
+                             int64_t duration) {
+
+    printf("%s:\n%8s %12s %12s %11s\n", variantNames[run.variant], "threads",
+           "games/s", "pieces/s", "efficiency");
+
+    double single = 0;
+    double efficiency = 1;
+    for (int threadCount : threadCounts) {
+        Throughput result = measure(run, threadCount, duration);
+        single = threadCount == 1 ? result.games : single;
+        efficiency = single > 0 ? result.games / (threadCount * single) : 0;
+        printf("%8d %12.0f %12.0f %10.1f%%\n", threadCount, result.games,
+               result.pieces, efficiency * 100);
+    }
+    return efficiency;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    int maxThreads = std::thread::hardware_concurrency();
+    int64_t duration = 1000;
+    const char *botName = "heuristic";
+    int maxPieces = 200;
+    bool isPinned = false;
+    bool isDiagnosed = false;
+
+    static struct option options[] = {
+        {"threads", required_argument, NULL, 'j'},
+        {"duration", required_argument, NULL, 'd'},
+        {"bot", required_argument, NULL, 'b'},
+        {"pieces", required_argument, NULL, 'p'},
+        {"pin", no_argument, NULL, 'P'},
+        {"diagnose", no_argument, NULL, 'D'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "j:d:b:p:PD", options, NULL)) !=
+           -1) {
+        switch (option) {
+        case 'j':
+            maxThreads = atoi(optarg);
+            break;
+        case 'd':
+            duration = atoll(optarg);
+            break;
+        case 'b':
+            botName = optarg;
+            break;
+        case 'p':
+            maxPieces = atoi(optarg);
+            break;
+        case 'P':
+            isPinned = true;
+            break;
+        case 'D':
+            isDiagnosed = true;
+            break;
+        default:
+            printf("Usage: %s [--threads=N] [--duration=MS] [--bot=NAME]\n"
+                   "    [--pieces=N] [--pin] [--diagnose]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+
+    ScalingRun run;
+    run.player = findBot(botName);
+    run.maxPieces = maxPieces;
+    run.isPinned = isPinned;
+    if (run.player < 0) {
+        printf("Unknown bot: %s\n", botName);
+        return 1;
+    }
+    maxThreads = maxThreads < 1 ? 1 : maxThreads;
+    maxThreads = maxThreads > maxScalingThreads ? maxScalingThreads : maxThreads;
+
+    // Powers of two and the largest count.
+    std::vector<int> threadCounts;
+    for (int count = 1; count < maxThreads; count *= 2) {
+        threadCounts.push_back(count);
+    }
+    threadCounts.push_back(maxThreads);
+
+    run.variant = variantPrivate;
+    double efficiency = measureScaling(run, threadCounts, duration);
+    if (!isDiagnosed) {
+        return 0;
+    }
+
+    double efficiencies[variantCount] = {efficiency};
+    for (int variant = 1; variant < variantCount; variant++) {
+        run.variant = variant;
+        efficiencies[variant] = measureScaling(run, threadCounts, duration);
+    }
+
+    // Differences below measurement noise are not reported.
+    printf("At %d threads:\n", maxThreads);
+    double sharing = efficiencies[variantPadded] - efficiencies[variantAdjacent];
+    double allocation = efficiencies[variantPrivate] - efficiencies[variantAllocating];
+    printf("  false sharing costs %.1f%% of efficiency%s\n", sharing * 100,
+           sharing > 0.05 ? ", counters of threads must not share cache line" : "");
+    printf("  allocation per lock costs %.1f%% of efficiency%s\n", allocation * 100,
+           allocation > 0.05 ? ", allocator is contended" : "");
+    if (maxThreads == 1) {
+        printf("  one thread can't show sharing, use --threads\n");
+    }
+    return 0;
+}
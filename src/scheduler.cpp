@@ -0,0 +1,80 @@
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "../include/scheduler.h"
+
+/**
+ * Range of job indices owned by one worker.
+ *
+ * Owner takes jobs from the front, other workers steal from the back.
+ * Padded so queues of different workers don't share cache line.
+ */
+struct WorkQueue {
+    std::mutex lock;
+    int begin;
+    int end;
+    char padding[64];
+};
+
+/**
+ * Taking job from own queue or stealing it from another one.
+ *
+ * @return Job index, -1 if all queues are empty.
+ */
+static int takeJob(WorkQueue queues[], int threadCount, int worker) {
+
+    {
+        std::lock_guard<std::mutex> guard(queues[worker].lock);
+        if (queues[worker].begin < queues[worker].end) {
+            return queues[worker].begin++;
+        }
+    }
+
+    for (int i = 1; i < threadCount; i++) {
+        WorkQueue &victim = queues[(worker + i) % threadCount];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.begin < victim.end) {
+            return --victim.end;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Running jobs on several threads with work stealing.
+ *
+ * Jobs are split evenly between threads at start, threads
+ * which run out of jobs steal them from others. Returns
+ * after all jobs are done.
+ *
+ * @param jobCount Number of jobs, indices passed to job are 0 to jobCount - 1.
+ * @param threadCount Number of threads, at least 1.
+ * @param job Function running one job.
+ * @param context Passed to every job.
+ */
+void runJobs(int jobCount, int threadCount, Job job, void *context) {
+
+    std::vector<WorkQueue> queues(threadCount);
+    for (int i = 0; i < threadCount; i++) {
+        queues[i].begin = (long long)jobCount * i / threadCount;
+        queues[i].end = (long long)jobCount * (i + 1) / threadCount;
+    }
+
+    auto work = [&](int worker) {
+        int index;
+        while ((index = takeJob(queues.data(), threadCount, worker)) >= 0) {
+            job(index, worker, context);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
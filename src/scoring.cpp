@@ -0,0 +1,67 @@
+#include <cstring>
+#include "../include/scoring.h"
+
+/**
+ * Finding ruleset by name.
+ *
+ * @return Ruleset index, -1 if there is no such ruleset.
+ */
+int findRuleset(const char *name) {
+
+    for (int i = 0; i < rulesetCount; i++) {
+        if (strcmp(rulesets[i].name, name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Increasing score after piece was locked.
+ *
+ * Uses game.lastSpin, game.combo and game.backToBack.
+ *
+ * @param lineCount Number of lines cleared by piece.
+ * @param perfectClear If board is empty after clearing lines.
+ */
+void updateScore(Game &game, int lineCount, bool perfectClear) {
+
+    const Ruleset &rules = rulesets[game.options.ruleset];
+    int multiplier = rules.levelMultiplier ? game.level + 1 : 1;
+    int lineScore = rules.spinScores[game.lastSpin][lineCount];
+
+    if (lineCount > 0) {
+        bool difficult = lineCount == 4 || game.lastSpin != spinNone;
+        if (difficult && game.backToBack) {
+            lineScore = lineScore * rules.backToBackPercent / 100;
+        }
+        game.backToBack = difficult;
+        game.combo++;
+    } else {
+        game.combo = -1;
+    }
+
+    game.score += rules.pieceScore;
+    game.score += lineScore * multiplier;
+    game.score += rules.comboScore * (game.combo > 0 ? game.combo : 0) *
+                  multiplier;
+    if (perfectClear) {
+        game.score += rules.perfectClearScores[lineCount] * multiplier;
+    }
+    game.lines += lineCount;
+}
+
+/**
+ * Increasing level after piece was locked.
+ */
+void updateLevel(Game &game) {
+
+    const Ruleset &rules = rulesets[game.options.ruleset];
+    int level = rules.levelPieces > 0 ? game.pieceCount / rules.levelPieces
+                                      : game.lines / rules.levelLines;
+
+    game.level = level < rules.maxLevel ? level : rules.maxLevel;
+    int speed = level < maxLevelCount ? level : maxLevelCount - 1;
+    game.gravity = game.options.gravity20G ? gravity20G : rules.gravity[speed];
+}
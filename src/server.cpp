@@ -0,0 +1,930 @@
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "../include/counters.h"
+#include "../include/server.h"
+#include "../include/eventloop.h"
+
+// Terminals don't report key release, so held key is
+// released once it stops repeating.
+const int64_t keyReleaseTime = 50000; // us.
+
+const int maxEvents = 64;
+
+// Session sending this many invalid inputs is closed.
+const int maxRejectedInputs = 20;
+
+// Longest timestamped input line, longer one ends session.
+const size_t maxInputLineLength = 63;
+
+// Games are advanced at most this late.
+const int64_t timerResolution = 1000; // us.
+
+/**
+ * Switching descriptor to non-blocking mode.
+ */
+static void setNonBlocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * Closing spectator connection and freeing it.
+ */
+static void closeSpectator(EventLoop &loop, Spectator *viewer) {
+
+    if (viewer->isWatching) {
+        std::vector<Spectator *> &viewers = loop.games[viewer->game]->viewers;
+        for (size_t i = 0; i < viewers.size(); i++) {
+            if (viewers[i] == viewer) {
+                viewers.erase(viewers.begin() + i);
+                break;
+            }
+        }
+    }
+
+    dropFrames(*viewer);
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, viewer->fd, NULL);
+    close(viewer->fd);
+    loop.spectators[viewer->fd] = NULL;
+    delete viewer;
+}
+
+/**
+ * Making game visible to spectators of all loops.
+ *
+ * Game id must be already set.
+ */
+void registerGame(Server &gameServer, EventLoop &loop, Session *session) {
+
+    loop.games[session->id] = session;
+
+    std::lock_guard<std::mutex> lock(gameServer.gamesMutex);
+    gameServer.games[session->id] = &loop;
+}
+
+/**
+ * Closing spectators of game and hiding it.
+ */
+static void unregisterGame(Server &gameServer, EventLoop &loop,
+                           Session *session) {
+
+    while (!session->viewers.empty()) {
+        closeSpectator(loop, session->viewers.back());
+    }
+    loop.games.erase(session->id);
+
+    std::lock_guard<std::mutex> lock(gameServer.gamesMutex);
+    gameServer.games.erase(session->id);
+}
+
+/**
+ * Closing session and freeing it.
+ */
+static void closeSession(Server &gameServer, EventLoop &loop,
+                         Session *session) {
+
+    unregisterGame(gameServer, loop, session);
+    cancelTimer(session->timer);
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, session->fd, NULL);
+    close(session->fd);
+    loop.sessions[session->fd] = NULL;
+    loop.sessionCount--;
+    delete session;
+}
+
+/**
+ * Changing events watched on client socket.
+ */
+static void watchSocket(EventLoop &loop, int fd, bool isWaiting) {
+
+    epoll_event event = {};
+    event.events = isWaiting ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_MOD, fd, &event);
+}
+
+/**
+ * Sending pending output without blocking.
+ *
+ * Socket is watched for writability while output remains.
+ *
+ * @return False if session was closed.
+ */
+bool flushSession(Server &gameServer, EventLoop &loop, Session *session) {
+
+    while (session->written < session->output.size()) {
+        ssize_t sent = send(session->fd,
+                            session->output.data() + session->written,
+                            session->output.size() - session->written,
+                            MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!session->isWaiting) {
+                watchSocket(loop, session->fd, true);
+                session->isWaiting = true;
+            }
+            return true;
+        }
+        if (sent < 0) {
+            closeSession(gameServer, loop, session);
+            return false;
+        }
+        session->written += sent;
+        countEvent(counterBytesEmitted, sent);
+    }
+
+    if (session->isWaiting) {
+        watchSocket(loop, session->fd, false);
+        session->isWaiting = false;
+    }
+    session->output.clear();
+    session->written = 0;
+
+    if (session->isClosing) {
+        closeSession(gameServer, loop, session);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Sending queued frames to spectator.
+ *
+ * Spectator too far behind is sent keyframe of current
+ * state instead of all missed deltas.
+ */
+static void sendFrames(EventLoop &loop, Spectator *viewer) {
+
+    if (viewer->isWatching && (int)viewer->frames.size() > maxPendingFrames) {
+        std::string keyframe;
+        renderFrame(NULL, loop.games[viewer->game]->published, keyframe);
+        dropUnsentFrames(*viewer);
+        queueFrame(*viewer, createSharedFrame(keyframe, 1));
+    }
+
+    int result = flushSpectator(*viewer);
+    if (result < 0) {
+        closeSpectator(loop, viewer);
+    } else if ((result == 0) != viewer->isWaiting) {
+        watchSocket(loop, viewer->fd, result == 0);
+        viewer->isWaiting = result == 0;
+    }
+}
+
+/**
+ * Rendering game as difference from last sent frame.
+ *
+ * Slow client isn't sent new frame until previous one
+ * is written, it gets the difference to latest state later.
+ * Spectators share one difference, encoded once per update.
+ */
+static bool renderSession(Server &gameServer, EventLoop &loop,
+                          Session *session) {
+
+    if (session->fd < 0 && session->viewers.empty()) {
+        return true;
+    }
+
+    Frame next;
+    drawGame(session->game, next);
+
+    if (!session->viewers.empty()) {
+        std::string delta;
+        renderFrame(&session->published, next, delta);
+        publishFrame(session->viewers, delta);
+        for (size_t i = session->viewers.size(); i-- > 0;) {
+            sendFrames(loop, session->viewers[i]);
+        }
+    }
+    session->published = next;
+
+    if (session->fd < 0 || !session->output.empty()) {
+        return true;
+    }
+
+    renderFrame(session->hasFrame ? &session->frame : NULL, next,
+                session->output);
+    session->frame = next;
+    session->hasFrame = true;
+
+    return flushSession(gameServer, loop, session);
+}
+
+/**
+ * Starting new game of session.
+ */
+static void startSession(Server &gameServer, Session *session) {
+
+    GameOptions options = gameServer.options.game;
+    options.seed += gameServer.sessionSeed++;
+    initGame(session->game, options);
+    initVerifier(session->verifier);
+    session->startTime = nowMicros();
+    session->heldKey = -1;
+    session->timer.owner = session;
+}
+
+/**
+ * Advancing game to current time, rendering it and
+ * scheduling its next event.
+ *
+ * Verified game runs maxInputLag behind, so timestamped inputs
+ * delayed by network are still applied at their own time.
+ */
+void updateSession(Server &gameServer, EventLoop &loop, Session *session) {
+
+    int64_t delay = gameServer.options.verifyInputs ? maxInputLag : 0;
+    int64_t now = nowMicros() - session->startTime - delay;
+    if (session->heldKey >= 0 &&
+        now >= session->heldKeyTime + keyReleaseTime) {
+        releaseKey(session->game, session->heldKey,
+                   session->heldKeyTime + keyReleaseTime);
+        session->heldKey = -1;
+    }
+    advanceGame(session->game, now);
+
+    if (session->fd < 0 && session->game.isGameOver) {
+        startSession(gameServer, session);
+    }
+    if (!renderSession(gameServer, loop, session)) {
+        return;
+    }
+
+    if (session->game.isGameOver) {
+        return;
+    }
+    int64_t next = nextEventTime(session->game);
+    if (session->heldKey >= 0 &&
+        session->heldKeyTime + keyReleaseTime < next) {
+        next = session->heldKeyTime + keyReleaseTime;
+    }
+    scheduleTimer(loop.wheel, session->timer, session->startTime + delay + next);
+}
+
+/**
+ * Accepting all waiting clients of listening socket.
+ */
+static void acceptSessions(Server &gameServer, EventLoop &loop, int listenFd) {
+
+    int fd;
+    while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+        int flag = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+
+        Session *session = new Session();
+        session->fd = fd;
+        initTimerNode(session->timer);
+        startSession(gameServer, session);
+
+        if ((int)loop.sessions.size() <= fd) {
+            loop.sessions.resize(fd + 1);
+        }
+        loop.sessions[fd] = session;
+        loop.sessionCount++;
+        session->id = gameServer.nextGameId++;
+        registerGame(gameServer, loop, session);
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &event);
+        updateSession(gameServer, loop, session);
+    }
+}
+
+/**
+ * Applying timestamped input line, "TIME +KEY" for press
+ * or "TIME -KEY" for release, TIME in microseconds since
+ * game start and KEY one of game characters.
+ *
+ * Client which keeps sending impossible input is disconnected.
+ */
+static void applyInputLine(Session *session, int64_t now) {
+
+    if (session->line == "Q") {
+        session->isClosing = true;
+        return;
+    }
+
+    // Malformed line counts as invalid key.
+    long long time = 0;
+    char sign = 0, character = 0;
+    sscanf(session->line.c_str(), "%lld %c%c", &time, &sign, &character);
+
+    int player;
+    InputEvent input;
+    input.time = time;
+    input.key = sign == '+' || sign == '-' ? keyFromChar(character, player) : -1;
+    input.isPress = sign == '+';
+    countEvent(counterInputEvents);
+    submitInput(session->verifier, session->game, input, now);
+
+    if (rejectedInputs(session->verifier) > maxRejectedInputs) {
+        session->isClosing = true;
+    }
+}
+
+/**
+ * Applying keys sent by client.
+ *
+ * Every key is applied at the time it was read, or at time
+ * client sent with it when inputs are verified. Q or Ctrl-C
+ * ends session, after game over any key does.
+ */
+static void readSession(Server &gameServer, EventLoop &loop,
+                        Session *session) {
+
+    char buffer[256];
+    ssize_t count;
+
+    while ((count = recv(session->fd, buffer, sizeof(buffer), 0)) > 0) {
+        Game &game = session->game;
+        int64_t now = nowMicros() - session->startTime;
+
+        for (ssize_t i = 0; i < count && !session->isClosing; i++) {
+            if (gameServer.options.verifyInputs && buffer[i] != 3 &&
+                !game.isGameOver) {
+                if (buffer[i] == '\n') {
+                    applyInputLine(session, now);
+                    session->line.clear();
+                } else if (session->line.size() >= maxInputLineLength) {
+                    session->isClosing = true;
+                } else if (buffer[i] != '\r') {
+                    session->line += buffer[i];
+                }
+                continue;
+            }
+            if (buffer[i] == 'Q' || buffer[i] == 3 || game.isGameOver) {
+                session->isClosing = true;
+                continue;
+            }
+
+            int player;
+            int key = keyFromChar(buffer[i], player);
+            if (key < 0) {
+                continue;
+            }
+            if (key <= keyDown && session->heldKey >= 0 &&
+                session->heldKey != key) {
+                releaseKey(game, session->heldKey, now);
+            }
+            pressKey(game, key, now);
+            countEvent(counterInputEvents);
+            if (key <= keyDown) {
+                session->heldKey = key;
+                session->heldKeyTime = now;
+            }
+        }
+    }
+
+    if (count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                       errno != EINTR)) {
+        closeSession(gameServer, loop, session);
+        return;
+    }
+
+    if (session->isClosing) {
+        cancelTimer(session->timer);
+        session->output += "\x1b[?25h\x1b[2J\x1b[H";
+        if (rejectedInputs(session->verifier) > maxRejectedInputs) {
+            session->output += "Too many invalid inputs\r\n";
+        }
+        if (!session->isWaiting) {
+            flushSession(gameServer, loop, session);
+        }
+    } else {
+        updateSession(gameServer, loop, session);
+    }
+}
+
+/**
+ * Accepting spectators and asking them to choose game.
+ */
+static void acceptSpectators(Server &gameServer, EventLoop &loop,
+                             int listenFd) {
+
+    int fd;
+    while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+        Spectator *viewer = new Spectator();
+        viewer->fd = fd;
+        viewer->game = -1;
+
+        if ((int)loop.spectators.size() <= fd) {
+            loop.spectators.resize(fd + 1);
+        }
+        loop.spectators[fd] = viewer;
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &event);
+
+        std::string menu = "Games:";
+        {
+            std::lock_guard<std::mutex> lock(gameServer.gamesMutex);
+            for (std::map<int, EventLoop *>::iterator it =
+                     gameServer.games.begin();
+                 it != gameServer.games.end(); it++) {
+                menu += " " + std::to_string(it->first);
+            }
+        }
+        menu += "\r\nGame number: ";
+        queueFrame(*viewer, createSharedFrame(menu, 1));
+        sendFrames(loop, viewer);
+    }
+}
+
+/**
+ * Starting to send game to spectator, beginning with keyframe.
+ *
+ * Spectator is closed if game has ended meanwhile.
+ */
+void attachSpectator(EventLoop &loop, Spectator *viewer) {
+
+    if ((int)loop.spectators.size() <= viewer->fd) {
+        loop.spectators.resize(viewer->fd + 1);
+    }
+    loop.spectators[viewer->fd] = viewer;
+
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = viewer->fd;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, viewer->fd, &event);
+
+    std::map<int, Session *>::iterator game = loop.games.find(viewer->game);
+    if (game == loop.games.end()) {
+        closeSpectator(loop, viewer);
+        return;
+    }
+
+    Session *session = game->second;
+    std::string keyframe;
+    drawGame(session->game, session->published);
+    renderFrame(NULL, session->published, keyframe);
+    queueFrame(*viewer, createSharedFrame(keyframe, 1));
+    viewer->isWatching = true;
+    session->viewers.push_back(viewer);
+    sendFrames(loop, viewer);
+}
+
+/**
+ * Reading spectator input.
+ *
+ * Game number ends with Enter, spectator is then moved
+ * to loop running the game. Q or Ctrl-C disconnects.
+ */
+static void readSpectator(Server &gameServer, EventLoop &loop,
+                          Spectator *viewer) {
+
+    char buffer[64];
+    ssize_t count;
+    bool isChosen = false;
+    bool isClosing = false;
+
+    while ((count = recv(viewer->fd, buffer, sizeof(buffer), 0)) > 0) {
+        for (ssize_t i = 0; i < count && !viewer->isWatching; i++) {
+            if (buffer[i] >= '0' && buffer[i] <= '9') {
+                viewer->game = (viewer->game < 0 ? 0 : viewer->game * 10) +
+                               buffer[i] - '0';
+            } else if ((buffer[i] == '\r' || buffer[i] == '\n') &&
+                       viewer->game >= 0) {
+                isChosen = true;
+            }
+        }
+        for (ssize_t i = 0; i < count; i++) {
+            isClosing |= buffer[i] == 'Q' || buffer[i] == 3;
+        }
+    }
+
+    if (isClosing || count == 0 ||
+        (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+         errno != EINTR)) {
+        closeSpectator(loop, viewer);
+        return;
+    }
+    if (!isChosen || viewer->isWatching) {
+        return;
+    }
+
+    EventLoop *owner = NULL;
+    {
+        std::lock_guard<std::mutex> lock(gameServer.gamesMutex);
+        std::map<int, EventLoop *>::iterator game =
+            gameServer.games.find(viewer->game);
+        if (game != gameServer.games.end()) {
+            owner = game->second;
+        }
+    }
+
+    if (!owner) {
+        viewer->game = -1;
+        queueFrame(*viewer, createSharedFrame("\r\nNo such game\r\nGame number: ", 1));
+        sendFrames(loop, viewer);
+        return;
+    }
+
+    epoll_ctl(loop.epollFd, EPOLL_CTL_DEL, viewer->fd, NULL);
+    loop.spectators[viewer->fd] = NULL;
+    if (owner == &loop) {
+        attachSpectator(loop, viewer);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(owner->mailboxMutex);
+    owner->mailbox.push_back(viewer);
+    uint64_t value = 1;
+    if (write(owner->wakeFd, &value, sizeof(value)) < 0) {
+        perror("eventfd");
+    }
+}
+
+/**
+ * Attaching spectators moved from other loops.
+ */
+static void readMailbox(EventLoop &loop) {
+
+    uint64_t value;
+    if (read(loop.wakeFd, &value, sizeof(value)) < 0) {
+        return;
+    }
+
+    std::vector<Spectator *> viewers;
+    {
+        std::lock_guard<std::mutex> lock(loop.mailboxMutex);
+        viewers.swap(loop.mailbox);
+    }
+    for (size_t i = 0; i < viewers.size(); i++) {
+        attachSpectator(loop, viewers[i]);
+    }
+}
+
+/**
+ * Updating every game whose event is due.
+ *
+ * Games due in the same timer slot are updated as one batch.
+ */
+static void tickSessions(Server &gameServer, EventLoop &loop) {
+
+    TimerNode expired;
+    initTimerNode(expired);
+    int64_t now = nowMicros();
+    expireTimers(loop.wheel, now, expired);
+
+    // Update is overrun if it comes after the next tick.
+    TimerNode *node;
+    while ((node = popTimer(expired))) {
+        countEvent(counterTicks);
+        if (now - node->due >= timerResolution) {
+            countEvent(counterTickOverruns);
+        }
+        updateSession(gameServer, loop, (Session *)node->owner);
+    }
+}
+
+/**
+ * Running event loop until server is stopped.
+ */
+static void runEventLoop(Server *serverPointer, EventLoop *loopPointer) {
+
+    Server &gameServer = *serverPointer;
+    EventLoop &loop = *loopPointer;
+    epoll_event events[maxEvents];
+    bool isRunning = true;
+    registerCounters();
+
+    while (isRunning) {
+        int count = epoll_wait(loop.epollFd, events, maxEvents, -1);
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == gameServer.stopFd) {
+                isRunning = false;
+            } else if (fd == gameServer.listenFds[0] || fd == gameServer.listenFds[1]) {
+                acceptSessions(gameServer, loop, fd);
+            } else if (fd == gameServer.listenFds[2]) {
+                acceptSpectators(gameServer, loop, fd);
+            } else if (fd == loop.wakeFd) {
+                readMailbox(loop);
+            } else if (fd == loop.timerFd) {
+                uint64_t expirations;
+                if (read(loop.timerFd, &expirations, sizeof(expirations)) > 0) {
+                    tickSessions(gameServer, loop);
+                }
+            } else if (fd < (int)loop.sessions.size() && loop.sessions[fd]) {
+                Session *session = loop.sessions[fd];
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    closeSession(gameServer, loop, session);
+                    continue;
+                }
+                if ((events[i].events & EPOLLOUT) &&
+                    !flushSession(gameServer, loop, session)) {
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    readSession(gameServer, loop, session);
+                }
+            } else if (fd < (int)loop.spectators.size() && loop.spectators[fd]) {
+                Spectator *viewer = loop.spectators[fd];
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    closeSpectator(loop, viewer);
+                    continue;
+                }
+                if (events[i].events & EPOLLOUT) {
+                    sendFrames(loop, viewer);
+                    if (!loop.spectators[fd]) {
+                        continue;
+                    }
+                }
+                if (events[i].events & EPOLLIN) {
+                    readSpectator(gameServer, loop, viewer);
+                }
+            }
+        }
+    }
+
+    // Games are taken by new server.
+    if (gameServer.isHandingOff) {
+        return;
+    }
+
+    for (size_t fd = 0; fd < loop.sessions.size(); fd++) {
+        if (loop.sessions[fd]) {
+            closeSession(gameServer, loop, loop.sessions[fd]);
+        }
+    }
+    for (size_t i = 0; i < loop.simulated.size(); i++) {
+        unregisterGame(gameServer, loop, loop.simulated[i]);
+        cancelTimer(loop.simulated[i]->timer);
+        delete loop.simulated[i];
+    }
+    for (size_t fd = 0; fd < loop.spectators.size(); fd++) {
+        if (loop.spectators[fd]) {
+            closeSpectator(loop, loop.spectators[fd]);
+        }
+    }
+}
+
+/**
+ * Creating listening socket.
+ *
+ * @param port TCP port on loopback, ignored for Unix socket.
+ * @param unixPath Path of Unix socket, NULL for TCP.
+ * @return Socket, -1 on failure.
+ */
+static int listenSocket(int port, const char *unixPath) {
+
+    int fd = socket(unixPath ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int result;
+    if (unixPath) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, unixPath, sizeof(address.sun_path) - 1);
+        unlink(unixPath);
+        result = bind(fd, (sockaddr *)&address, sizeof(address));
+    } else {
+        int flag = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = bind(fd, (sockaddr *)&address, sizeof(address));
+    }
+
+    if (result < 0 || listen(fd, SOMAXCONN) < 0) {
+        close(fd);
+        return -1;
+    }
+    setNonBlocking(fd);
+    return fd;
+}
+
+/**
+ * Closing listening sockets which were opened.
+ */
+void closeListeners(Server &gameServer) {
+
+    for (int i = 0; i < 3; i++) {
+        if (gameServer.listenFds[i] >= 0) {
+            close(gameServer.listenFds[i]);
+        }
+    }
+    if (gameServer.controlFd >= 0) {
+        close(gameServer.controlFd);
+    }
+    if (gameServer.options.unixPath) {
+        unlink(gameServer.options.unixPath);
+    }
+    if (gameServer.options.controlPath) {
+        unlink(gameServer.options.controlPath);
+    }
+}
+
+/**
+ * Opening sockets and starting event loop threads.
+ *
+ * Every loop watches listening sockets exclusively, so new
+ * client wakes single loop, which then serves it until the end.
+ *
+ * @return False if socket couldn't be opened.
+ */
+bool startServer(Server &gameServer, const ServerOptions &options) {
+
+    gameServer.options = options;
+    gameServer.port = -1;
+    gameServer.sessionSeed = 0;
+    gameServer.spectatorPort = -1;
+    gameServer.nextGameId = 0;
+    for (int i = 0; i < 3; i++) {
+        gameServer.listenFds[i] = -1;
+    }
+    gameServer.controlFd = -1;
+
+    if (options.port >= 0) {
+        gameServer.listenFds[0] = listenSocket(options.port, NULL);
+        if (gameServer.listenFds[0] < 0) {
+            return false;
+        }
+        sockaddr_in address;
+        socklen_t length = sizeof(address);
+        getsockname(gameServer.listenFds[0], (sockaddr *)&address, &length);
+        gameServer.port = ntohs(address.sin_port);
+    }
+    if (options.unixPath) {
+        gameServer.listenFds[1] = listenSocket(0, options.unixPath);
+        if (gameServer.listenFds[1] < 0) {
+            closeListeners(gameServer);
+            return false;
+        }
+    }
+    if (options.spectatorPort >= 0) {
+        gameServer.listenFds[2] = listenSocket(options.spectatorPort, NULL);
+        if (gameServer.listenFds[2] < 0) {
+            closeListeners(gameServer);
+            return false;
+        }
+        sockaddr_in address;
+        socklen_t length = sizeof(address);
+        getsockname(gameServer.listenFds[2], (sockaddr *)&address, &length);
+        gameServer.spectatorPort = ntohs(address.sin_port);
+    }
+    if (options.controlPath) {
+        gameServer.controlFd = listenSocket(0, options.controlPath);
+        if (gameServer.controlFd < 0) {
+            closeListeners(gameServer);
+            return false;
+        }
+    }
+
+    memset(&gameServer.lateness, 0, sizeof(gameServer.lateness));
+    createEventLoops(gameServer);
+
+    for (int i = 0; i < options.simulated; i++) {
+        EventLoop &loop = *gameServer.loops[i % options.threads];
+        Session *session = new Session();
+        session->fd = -1;
+        initTimerNode(session->timer);
+        startSession(gameServer, session);
+        loop.simulated.push_back(session);
+        session->id = gameServer.nextGameId++;
+        registerGame(gameServer, loop, session);
+        updateSession(gameServer, loop, session);
+    }
+
+    startEventLoops(gameServer);
+    return true;
+}
+
+/**
+ * Creating event loops watching listening sockets.
+ */
+void createEventLoops(Server &gameServer) {
+
+    gameServer.isHandingOff = false;
+    gameServer.stopFd = eventfd(0, EFD_NONBLOCK);
+
+    itimerspec interval = {};
+    interval.it_interval.tv_nsec = timerResolution * 1000;
+    interval.it_value = interval.it_interval;
+
+    for (int i = 0; i < gameServer.options.threads; i++) {
+        EventLoop *loop = new EventLoop();
+        loop->epollFd = epoll_create1(0);
+        loop->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        timerfd_settime(loop->timerFd, 0, &interval, NULL);
+        loop->sessionCount = 0;
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK);
+        initWheel(loop->wheel, timerResolution, nowMicros());
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = loop->timerFd;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->timerFd, &event);
+        event.data.fd = gameServer.stopFd;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, gameServer.stopFd, &event);
+        event.data.fd = loop->wakeFd;
+        epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, loop->wakeFd, &event);
+        for (int j = 0; j < 3; j++) {
+            if (gameServer.listenFds[j] >= 0) {
+                event.events = EPOLLIN | EPOLLEXCLUSIVE;
+                event.data.fd = gameServer.listenFds[j];
+                epoll_ctl(loop->epollFd, EPOLL_CTL_ADD, gameServer.listenFds[j],
+                          &event);
+            }
+        }
+
+        gameServer.loops.push_back(loop);
+    }
+}
+
+/**
+ * Starting thread of every event loop.
+ */
+void startEventLoops(Server &gameServer) {
+
+    for (size_t i = 0; i < gameServer.loops.size(); i++) {
+        gameServer.threads.push_back(
+            std::thread(runEventLoop, &gameServer, gameServer.loops[i]));
+    }
+}
+
+/**
+ * Counting connected clients of all loops.
+ */
+int serverSessions(const Server &gameServer) {
+
+    int count = 0;
+    for (size_t i = 0; i < gameServer.loops.size(); i++) {
+        count += gameServer.loops[i]->sessionCount;
+    }
+    return count;
+}
+
+/**
+ * Stopping loops, closing every session and socket.
+ *
+ * Lateness of game updates of all loops is collected.
+ */
+void stopServer(Server &gameServer) {
+
+    stopEventLoops(gameServer);
+    freeEventLoops(gameServer);
+    closeListeners(gameServer);
+}
+
+/**
+ * Waking all loops to stop and waiting for their threads.
+ */
+void stopEventLoops(Server &gameServer) {
+
+    uint64_t value = 1;
+    if (write(gameServer.stopFd, &value, sizeof(value)) < 0) {
+        perror("eventfd");
+    }
+    for (size_t i = 0; i < gameServer.threads.size(); i++) {
+        gameServer.threads[i].join();
+    }
+    gameServer.threads.clear();
+}
+
+/**
+ * Closing descriptors of stopped loops and
+ * collecting their lateness.
+ */
+void freeEventLoops(Server &gameServer) {
+
+    for (size_t i = 0; i < gameServer.loops.size(); i++) {
+        mergeLateness(gameServer.lateness, gameServer.loops[i]->wheel.lateness);
+        EventLoop *loop = gameServer.loops[i];
+        for (size_t j = 0; j < loop->mailbox.size(); j++) {
+            close(loop->mailbox[j]->fd);
+            delete loop->mailbox[j];
+        }
+        close(loop->wakeFd);
+        close(loop->timerFd);
+        close(loop->epollFd);
+        delete loop;
+    }
+    gameServer.loops.clear();
+    close(gameServer.stopFd);
+}
@@ -0,0 +1,191 @@
+/*
+ * Tetris server for raw-terminal clients.
+ *
+ * Every client connected over TCP or Unix socket plays its own
+ * game, rendered with ANSI escape sequences. Clients are spread
+ * over few event loop threads.
+ *
+ * Server started with --takeover connects to control socket of
+ * running one, which passes it all games and sockets and exits.
+ */
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../include/counters.h"
+#include "../include/handoff.h"
+#include "../include/scoring.h"
+#include "../include/server.h"
+#include "../include/terminal.h"
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    ServerOptions serverOptions;
+    serverOptions.game.seed = time(NULL);
+    const char *takeoverPath = NULL;
+
+    static struct option options[] = {{"port", required_argument, NULL, 'P'},
+                                      {"unix", required_argument, NULL, 'U'},
+                                      {"threads", required_argument, NULL, 'j'},
+                                      {"simulate", required_argument, NULL, 'S'},
+                                      {"spectate", required_argument, NULL, 'W'},
+                                      {"verify", no_argument, NULL, 'v'},
+                                      {"control", required_argument, NULL, 'C'},
+                                      {"takeover", required_argument, NULL, 'T'},
+                                      {"srs", no_argument, NULL, 's'},
+                                      {"rules", required_argument, NULL, 'r'},
+                                      {"seed", required_argument, NULL, 'e'},
+                                      {"bag", no_argument, NULL, 'b'},
+                                      {"preview", required_argument, NULL, 'p'},
+                                      {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "P:U:j:S:W:vC:T:sr:e:bp:", options, NULL)) != -1) {
+        switch (option) {
+        case 'P':
+            serverOptions.port = atoi(optarg);
+            break;
+        case 'U':
+            serverOptions.unixPath = optarg;
+            break;
+        case 'j':
+            serverOptions.threads = atoi(optarg);
+            if (serverOptions.threads < 1) {
+                printf("Server needs at least one thread\n");
+                return 1;
+            }
+            break;
+        case 'S':
+            serverOptions.simulated = atoi(optarg);
+            break;
+        case 'W':
+            serverOptions.spectatorPort = atoi(optarg);
+            break;
+        case 'v':
+            serverOptions.verifyInputs = true;
+            break;
+        case 'C':
+            serverOptions.controlPath = optarg;
+            break;
+        case 'T':
+            takeoverPath = optarg;
+            serverOptions.controlPath = optarg;
+            break;
+        case 's':
+            serverOptions.game.useSrs = true;
+            break;
+        case 'r':
+            serverOptions.game.ruleset = findRuleset(optarg);
+            if (serverOptions.game.ruleset < 0) {
+                printf("Unknown rules: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'e':
+            serverOptions.game.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'b':
+            serverOptions.game.useBag = true;
+            break;
+        case 'p':
+            serverOptions.game.previewDepth = atoi(optarg);
+            if (serverOptions.game.previewDepth < 1 ||
+                serverOptions.game.previewDepth > maxPreviewDepth) {
+                printf("Preview must be from 1 to %d\n", maxPreviewDepth);
+                return 1;
+            }
+            break;
+        default:
+            printf("Usage: %s [--port=N] [--unix=PATH] [--threads=N]\n"
+                   "    [--simulate=N] [--spectate=PORT] [--verify]\n"
+                   "    [--control=PATH] [--takeover=PATH] [--srs]\n"
+                   "    [--rules=project|nes|guideline] [--seed=N] [--bag]\n"
+                   "    [--preview=1-6]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+
+    // Signals are blocked before threads start, so only
+    // main thread receives them.
+    sigset_t signalMask;
+    sigemptyset(&signalMask);
+    sigaddset(&signalMask, SIGINT);
+    sigaddset(&signalMask, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signalMask, NULL);
+
+    Server gameServer;
+    if (takeoverPath) {
+        int channel = connectControlSocket(takeoverPath);
+        int64_t startTime = nowMicros();
+        if (channel < 0 || !takeOverServer(gameServer, serverOptions, channel)) {
+            perror("Can't take over server");
+            return 1;
+        }
+        close(channel);
+        printf("Took over %d sessions in %lld us\n", serverSessions(gameServer),
+               (long long)(nowMicros() - startTime));
+    } else if (!startServer(gameServer, serverOptions)) {
+        perror("Can't open server socket");
+        return 1;
+    }
+    if (gameServer.port >= 0) {
+        printf("Listening on 127.0.0.1:%d\n", gameServer.port);
+    }
+    if (serverOptions.unixPath) {
+        printf("Listening on %s\n", serverOptions.unixPath);
+    }
+    if (gameServer.spectatorPort >= 0) {
+        printf("Spectators on 127.0.0.1:%d\n", gameServer.spectatorPort);
+    }
+
+    // Waiting for signal or restarted server.
+    int signals = signalfd(-1, &signalMask, SFD_CLOEXEC);
+    pollfd events[2] = {{signals, POLLIN, 0}, {gameServer.controlFd, POLLIN, 0}};
+    while (poll(events, gameServer.controlFd >= 0 ? 2 : 1, -1) >= 0) {
+        if (events[0].revents) {
+            break;
+        }
+
+        int channel = accept(gameServer.controlFd, NULL, NULL);
+        if (channel < 0) {
+            continue;
+        }
+        int sessions = serverSessions(gameServer);
+        int64_t startTime = nowMicros();
+        bool isTaken = handOffServer(gameServer, channel);
+        close(channel);
+        if (!isTaken) {
+            printf("Handoff failed, still running %d sessions\n", sessions);
+            continue;
+        }
+        printf("Handed %d sessions over in %lld us\n", sessions,
+               (long long)(nowMicros() - startTime));
+        return 0;
+    }
+
+    signalfd_siginfo signal;
+    if (read(signals, &signal, sizeof(signal)) != sizeof(signal)) {
+        signal.ssi_signo = 0;
+    }
+    printf("Caught signal %d, closing %d sessions...\n", signal.ssi_signo,
+           serverSessions(gameServer));
+    stopServer(gameServer);
+
+    printf("Game update lateness: p50 %lld us, p99 %lld us, p99.9 %lld us\n",
+           (long long)latenessPercentile(gameServer.lateness, 50),
+           (long long)latenessPercentile(gameServer.lateness, 99),
+           (long long)latenessPercentile(gameServer.lateness, 99.9));
+    uint64_t totals[counterCount];
+    sumCounters(totals);
+    printCounters(totals);
+
+    return 0;
+}
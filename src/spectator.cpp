@@ -0,0 +1,124 @@
+#include <cerrno>
+#include <climits>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../include/counters.h"
+#include "../include/spectator.h"
+
+// Frames written by one writev() call.
+const int maxFrameBatch = 64;
+
+/**
+ * Creating frame owned by given number of spectators.
+ */
+SharedFrame *createSharedFrame(const std::string &bytes, int refs) {
+
+    SharedFrame *frame = new SharedFrame();
+    frame->refs = refs;
+    frame->bytes = bytes;
+    return frame;
+}
+
+/**
+ * Dropping one reference, frame is freed with the last one.
+ */
+void releaseSharedFrame(SharedFrame *frame) {
+
+    if (--frame->refs == 0) {
+        delete frame;
+    }
+}
+
+/**
+ * Adding frame to spectator queue, its reference is taken by spectator.
+ */
+void queueFrame(Spectator &viewer, SharedFrame *frame) {
+    viewer.frames.push_back(frame);
+}
+
+/**
+ * Encoding change once for all spectators of a game.
+ *
+ * @param bytes Delta from previous published frame.
+ */
+void publishFrame(std::vector<Spectator *> &viewers, const std::string &bytes) {
+
+    if (viewers.empty() || bytes.empty()) {
+        return;
+    }
+
+    SharedFrame *frame = createSharedFrame(bytes, viewers.size());
+    for (size_t i = 0; i < viewers.size(); i++) {
+        queueFrame(*viewers[i], frame);
+    }
+}
+
+/**
+ * Releasing every frame queued for spectator.
+ */
+void dropFrames(Spectator &viewer) {
+
+    for (size_t i = 0; i < viewer.frames.size(); i++) {
+        releaseSharedFrame(viewer.frames[i]);
+    }
+    viewer.frames.clear();
+    viewer.offset = 0;
+}
+
+/**
+ * Releasing frames not yet started, keeping partly sent first
+ * frame so that its escape sequences reach client whole.
+ */
+void dropUnsentFrames(Spectator &viewer) {
+
+    size_t kept = viewer.offset > 0 && !viewer.frames.empty() ? 1 : 0;
+    for (size_t i = kept; i < viewer.frames.size(); i++) {
+        releaseSharedFrame(viewer.frames[i]);
+    }
+    viewer.frames.resize(kept);
+}
+
+/**
+ * Writing queued frames with as few system calls as possible.
+ *
+ * @return 1 if everything was sent, 0 if socket is full,
+ * -1 if connection failed.
+ */
+int flushSpectator(Spectator &viewer) {
+
+    while (!viewer.frames.empty()) {
+        iovec parts[maxFrameBatch];
+        int count = 0;
+        for (size_t i = 0; i < viewer.frames.size() && count < maxFrameBatch;
+             i++, count++) {
+            size_t skip = i == 0 ? viewer.offset : 0;
+            parts[count].iov_base = (char *)viewer.frames[i]->bytes.data() + skip;
+            parts[count].iov_len = viewer.frames[i]->bytes.size() - skip;
+        }
+
+        msghdr message = {};
+        message.msg_iov = parts;
+        message.msg_iovlen = count;
+        // Same as writev(), but closed socket doesn't raise SIGPIPE.
+        ssize_t sent = sendmsg(viewer.fd, &message, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        countEvent(counterBytesEmitted, sent);
+
+        // Releasing fully sent frames.
+        while (!viewer.frames.empty() &&
+               (size_t)sent >= viewer.frames[0]->bytes.size() - viewer.offset) {
+            sent -= viewer.frames[0]->bytes.size() - viewer.offset;
+            releaseSharedFrame(viewer.frames[0]);
+            viewer.frames.pop_front();
+            viewer.offset = 0;
+        }
+        viewer.offset += sent;
+    }
+
+    return 1;
+}
@@ -0,0 +1,179 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include "../include/counters.h"
+#include "../include/functions.h"
+#include "../include/terminal.h"
+
+/**
+ * Getting monotonic time.
+ *
+ * @return Microseconds since unspecified point.
+ */
+int64_t nowMicros() {
+    return chrono::duration_cast<chrono::microseconds>(
+               chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Mapping pressed character to game key.
+ *
+ * @param player Set to 0 for default controls, 1 for vim-like ones.
+ * @return One of key constants, -1 for other characters.
+ */
+int keyFromChar(int pressedKey, int &player) {
+
+    player = 0;
+
+    switch (pressedKey) {
+    case 'a':
+        return keyLeft;
+    case 'd':
+        return keyRight;
+    case 's':
+        return keyDown;
+    case 'w':
+        return keyRotateRight;
+    case 'q':
+        return keyRotateLeft;
+    case 'e':
+        return keyHold;
+    }
+
+    player = 1;
+
+    switch (pressedKey) {
+    case 'h':
+        return keyLeft;
+    case 'l':
+        return keyRight;
+    case 'j':
+        return keyDown;
+    case 'k':
+    case ' ':
+        return keyRotateRight;
+    case 'i':
+        return keyRotateLeft;
+    case 'u':
+        return keyHold;
+    }
+
+    return -1;
+}
+
+/**
+ * Drawing small tetromino into frame, as printPiece() does.
+ */
+static void drawPiece(Frame &frame, int y, int x, int piece) {
+
+    for (int py = 1; py < 3 && piece >= 0; py++) {
+        for (int px = 0; px < tetrominoWidth; px++) {
+            if (pieceMasks[piece][1] & (1 << (py * tetrominoWidth + px))) {
+                frame.cells[y + py - 1][x + px] = "ABCDEFG"[piece];
+            }
+        }
+    }
+}
+
+/**
+ * Drawing text into frame, text is cut at the frame border.
+ */
+static void drawText(Frame &frame, int y, int x, const char *text) {
+
+    for (int i = 0; text[i] && x + i < frameWidth; i++) {
+        frame.cells[y][x + i] = text[i];
+    }
+}
+
+/**
+ * Drawing game with same layout as ncurses front-end.
+ *
+ * Hold is on the left of the field, upcoming pieces
+ * and stats are on the right.
+ */
+void drawGame(const Game &game, Frame &frame) {
+
+    int left = 6;
+    memset(frame.cells, ' ', sizeof(frame.cells));
+
+    for (int y = 0; y < fieldHeight; y++) {
+        for (int x = 0; x < fieldWidth; x++) {
+            frame.cells[y][left + x] =
+                " ABCDEFG=#"[game.board.field[y * fieldWidth + x]];
+        }
+    }
+
+    uint16_t mask = pieceMasks[game.currentPiece][game.currentRotation];
+    for (int y = 0; y < tetrominoWidth; y++) {
+        for (int x = 0; x < tetrominoWidth; x++) {
+            int px = game.currentX + x;
+            int py = game.currentY + y;
+            if ((mask & (1 << (y * tetrominoWidth + x))) && px >= 0 &&
+                px < fieldWidth && py >= 0 && py < fieldHeight) {
+                frame.cells[py][left + px] = "ABCDEFG"[game.currentPiece];
+            }
+        }
+    }
+
+    drawText(frame, 0, 0, "Hold");
+    drawPiece(frame, 1, 0, game.holdPiece);
+    drawText(frame, 0, left + fieldWidth + 2, "Next");
+    for (int i = 0; i < game.options.previewDepth; i++) {
+        drawPiece(frame, 1 + 3 * i, left + fieldWidth + 2,
+                  peekPiece(game.queue, i));
+    }
+
+    char text[frameWidth];
+    int stats = left + fieldWidth + 8;
+    snprintf(text, sizeof(text), "Score: %d", game.score);
+    drawText(frame, fieldHeight / 2 - 2, stats, text);
+    snprintf(text, sizeof(text), "Pieces: %d", game.pieceCount);
+    drawText(frame, fieldHeight / 2 - 1, stats, text);
+    snprintf(text, sizeof(text), "Level: %d", game.level);
+    drawText(frame, fieldHeight / 2, stats, text);
+    if (game.isGameOver) {
+        drawText(frame, fieldHeight, 0, "You lost! Press any key.");
+    }
+}
+
+/**
+ * Writing ANSI escape sequences turning one frame into another.
+ *
+ * Only changed runs of cells are written, each
+ * preceded by cursor movement.
+ *
+ * @param previous Frame on the terminal, NULL to clear and draw all.
+ * @param next Frame to show.
+ * @param out Bytes are appended here.
+ */
+void renderFrame(const Frame *previous, const Frame &next, std::string &out) {
+
+    char move[16];
+
+    if (!previous) {
+        out += "\x1b[?25l\x1b[2J";
+    }
+
+    for (int y = 0; y < frameHeight; y++) {
+        int x = 0;
+        while (x < frameWidth) {
+            if (previous && previous->cells[y][x] == next.cells[y][x]) {
+                x++;
+                continue;
+            }
+
+            int end = x + 1;
+            while (end < frameWidth &&
+                   (!previous || previous->cells[y][end] != next.cells[y][end])) {
+                end++;
+            }
+
+            snprintf(move, sizeof(move), "\x1b[%d;%dH", y + 1, x + 1);
+            out += move;
+            out.append(next.cells[y] + x, end - x);
+            countEvent(counterCellsWritten, end - x);
+            x = end;
+        }
+    }
+}
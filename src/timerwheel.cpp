@@ -0,0 +1,210 @@
+#include <cstring>
+#include "../include/timerwheel.h"
+
+/**
+ * Making node an empty list, also used for unscheduled timers.
+ */
+void initTimerNode(TimerNode &node) {
+    node.next = &node;
+    node.prev = &node;
+}
+
+/**
+ * Linking node at the end of list.
+ */
+static void appendTimer(TimerNode &list, TimerNode &node) {
+    node.prev = list.prev;
+    node.next = &list;
+    list.prev->next = &node;
+    list.prev = &node;
+}
+
+/**
+ * Moving all nodes of one list to the end of another.
+ */
+static void spliceTimers(TimerNode &to, TimerNode &from) {
+
+    if (from.next == &from) {
+        return;
+    }
+
+    from.next->prev = to.prev;
+    to.prev->next = from.next;
+    from.prev->next = &to;
+    to.prev = from.prev;
+    initTimerNode(from);
+}
+
+/**
+ * Creating empty wheel.
+ *
+ * @param resolution Microseconds per slot, timers fire
+ * up to this much late.
+ * @param time Current time, in microseconds.
+ */
+void initWheel(TimerWheel &wheel, int64_t resolution, int64_t time) {
+
+    wheel.resolution = resolution;
+    wheel.tick = time / resolution;
+    for (int level = 0; level < wheelLevels; level++) {
+        for (int slot = 0; slot < wheelSlots; slot++) {
+            initTimerNode(wheel.slots[level][slot]);
+        }
+    }
+    memset(&wheel.lateness, 0, sizeof(wheel.lateness));
+}
+
+/**
+ * Putting node into slot of the lowest level which reaches it.
+ *
+ * Timers due after the last level are put into its farthest
+ * slot and moved again when it comes.
+ *
+ * @param first Earliest slot time which isn't expired yet.
+ */
+static void insertTimer(TimerWheel &wheel, TimerNode &node, int64_t first) {
+
+    // Rounding up, so timer never fires early.
+    int64_t due = (node.due + wheel.resolution - 1) / wheel.resolution;
+    if (due < first) {
+        due = first;
+    }
+
+    int64_t delta = due - wheel.tick;
+    int level = 0;
+    while (level < wheelLevels - 1 &&
+           delta >= (int64_t)1 << (wheelSlotBits * (level + 1))) {
+        level++;
+    }
+    if (delta >= (int64_t)1 << (wheelSlotBits * wheelLevels)) {
+        due = wheel.tick + ((int64_t)1 << (wheelSlotBits * wheelLevels)) - 1;
+    }
+
+    int slot = (due >> (wheelSlotBits * level)) & (wheelSlots - 1);
+    appendTimer(wheel.slots[level][slot], node);
+}
+
+/**
+ * Scheduling timer, rescheduling it if already scheduled.
+ *
+ * @param due Time to fire, in microseconds.
+ */
+void scheduleTimer(TimerWheel &wheel, TimerNode &node, int64_t due) {
+
+    cancelTimer(node);
+    node.due = due;
+    insertTimer(wheel, node, wheel.tick + 1);
+}
+
+/**
+ * Removing timer from its slot, does nothing if it's not scheduled.
+ */
+void cancelTimer(TimerNode &node) {
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    initTimerNode(node);
+}
+
+/**
+ * Moving timers due up to time into expired list.
+ *
+ * Slots of higher levels are spread over lower levels when
+ * their time comes. Lateness of every expired timer is recorded.
+ *
+ * @param time Current time, in microseconds.
+ * @param expired List receiving timers in due order of slots.
+ */
+void expireTimers(TimerWheel &wheel, int64_t time, TimerNode &expired) {
+
+    int64_t now = time / wheel.resolution;
+    TimerNode *last = expired.prev;
+
+    while (wheel.tick < now) {
+        wheel.tick++;
+
+        for (int level = 1; level < wheelLevels; level++) {
+            int shift = wheelSlotBits * level;
+            if (wheel.tick & (((int64_t)1 << shift) - 1)) {
+                break;
+            }
+
+            TimerNode cascade;
+            initTimerNode(cascade);
+            spliceTimers(cascade,
+                         wheel.slots[level][(wheel.tick >> shift) &
+                                            (wheelSlots - 1)]);
+            TimerNode *node;
+            while ((node = popTimer(cascade))) {
+                insertTimer(wheel, *node, wheel.tick);
+            }
+        }
+
+        spliceTimers(expired,
+                     wheel.slots[0][wheel.tick & (wheelSlots - 1)]);
+    }
+
+    for (TimerNode *node = last->next; node != &expired; node = node->next) {
+        recordLateness(wheel.lateness, time - node->due);
+    }
+}
+
+/**
+ * Taking first timer of list.
+ *
+ * @return Unlinked timer, NULL if list is empty.
+ */
+TimerNode *popTimer(TimerNode &list) {
+
+    if (list.next == &list) {
+        return NULL;
+    }
+
+    TimerNode *node = list.next;
+    cancelTimer(*node);
+    return node;
+}
+
+/**
+ * Counting one delay in histogram.
+ *
+ * @param delay Microseconds, timers on time have 0.
+ */
+void recordLateness(Lateness &lateness, int64_t delay) {
+
+    int bucket = 0;
+    while (bucket < latenessBuckets - 1 && delay >= (int64_t)1 << bucket) {
+        bucket++;
+    }
+
+    lateness.counts[bucket]++;
+    lateness.total++;
+}
+
+/**
+ * Adding counts of one histogram to another.
+ */
+void mergeLateness(Lateness &to, const Lateness &from) {
+
+    for (int i = 0; i < latenessBuckets; i++) {
+        to.counts[i] += from.counts[i];
+    }
+    to.total += from.total;
+}
+
+/**
+ * Finding delay which given share of timers didn't exceed.
+ *
+ * @param percent Share from 0 to 100.
+ * @return Upper bound of bucket in microseconds, 0 if nothing was recorded.
+ */
+int64_t latenessPercentile(const Lateness &lateness, double percent) {
+
+    int64_t seen = 0;
+    for (int i = 0; i < latenessBuckets; i++) {
+        seen += lateness.counts[i];
+        if (seen > 0 && seen >= lateness.total * percent / 100) {
+            return i == 0 ? 0 : ((int64_t)1 << i) - 1;
+        }
+    }
+    return 0;
+}
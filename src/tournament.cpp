@@ -0,0 +1,206 @@
+/*
+ * Round-robin tournament between tetris bots.
+ *
+ * Every pair of bots plays given number of versus matches on
+ * worker threads. Match seed is base seed plus match index,
+ * so any match can be replayed with --replay.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <thread>
+#include <vector>
+#include "../include/bot.h"
+#include "../include/scheduler.h"
+
+const int maxTournamentPieces = 1000;
+
+/**
+ * One scheduled match.
+ */
+struct MatchResult {
+    int seats[2];   // Tournament players.
+    int players[2]; // Bot indices.
+    int winner;     // Index in seats, -1 for draw.
+    int scores[2];
+};
+
+struct Tournament {
+    uint64_t seed;
+    std::vector<MatchResult> results;
+};
+
+/**
+ * Playing one match of tournament.
+ */
+static void playTournamentMatch(int index, int worker, void *context) {
+
+    Tournament &tournament = *(Tournament *)context;
+    MatchResult &result = tournament.results[index];
+
+    result.winner = playMatch(result.players, 2, tournament.seed + index,
+                              maxTournamentPieces, result.scores);
+}
+
+/**
+ * Updating Elo ratings of two players after match.
+ *
+ * @param outcome 1 if first player won, 0 if lost, 0.5 for draw.
+ */
+static void updateElo(double &first, double &second, double outcome) {
+
+    double k = 16;
+    double expected = 1 / (1 + pow(10, (second - first) / 400));
+
+    first += k * (outcome - expected);
+    second -= k * (outcome - expected);
+}
+
+int main(int argc, char *argv[]) {
+
+    // Parsing options.
+    int games = 100;
+    int threadCount = std::thread::hardware_concurrency();
+    uint64_t seed = 1;
+    int replay = -1;
+    const char *resultsPath = NULL;
+
+    static struct option options[] = {
+        {"games", required_argument, NULL, 'g'},
+        {"threads", required_argument, NULL, 'j'},
+        {"seed", required_argument, NULL, 'e'},
+        {"replay", required_argument, NULL, 'r'},
+        {"results", required_argument, NULL, 'o'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "g:j:e:r:o:", options, NULL)) !=
+           -1) {
+        switch (option) {
+        case 'g':
+            games = atoi(optarg);
+            break;
+        case 'j':
+            threadCount = atoi(optarg);
+            break;
+        case 'e':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'r':
+            replay = atoi(optarg);
+            break;
+        case 'o':
+            resultsPath = optarg;
+            break;
+        default:
+            printf("Usage: %s [--games=N] [--threads=N] [--seed=N]\n"
+                   "    [--replay=MATCH] [--results=FILE] BOT BOT...\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<int> players;
+    for (int i = optind; i < argc; i++) {
+        int index = findBot(argv[i]);
+        if (index < 0) {
+            printf("Unknown bot: %s\n", argv[i]);
+            return 1;
+        }
+        players.push_back(index);
+    }
+    if (players.size() < 2) {
+        printf("Tournament needs at least 2 bots, available:");
+        for (int i = 0; i < botCount; i++) {
+            printf(" %s", bots[i].name);
+        }
+        printf("\n");
+        return 1;
+    }
+    if (threadCount < 1) {
+        threadCount = 1;
+    }
+
+    // Scheduling round-robin, sides are swapped every other game.
+    Tournament tournament;
+    tournament.seed = seed;
+    for (size_t i = 0; i < players.size(); i++) {
+        for (size_t j = i + 1; j < players.size(); j++) {
+            for (int g = 0; g < games; g++) {
+                MatchResult result;
+                result.seats[0] = g % 2 ? j : i;
+                result.seats[1] = g % 2 ? i : j;
+                result.players[0] = players[result.seats[0]];
+                result.players[1] = players[result.seats[1]];
+                tournament.results.push_back(result);
+            }
+        }
+    }
+    int matchCount = tournament.results.size();
+
+    if (replay >= 0) {
+        if (replay >= matchCount) {
+            printf("There are only %d matches\n", matchCount);
+            return 1;
+        }
+        MatchResult &result = tournament.results[replay];
+        playTournamentMatch(replay, 0, &tournament);
+        printf("Match %d, seed %llu: %s (%d) vs %s (%d), %s\n", replay,
+               (unsigned long long)(seed + replay),
+               bots[result.players[0]].name, result.scores[0],
+               bots[result.players[1]].name, result.scores[1],
+               result.winner < 0 ? "draw"
+                                 : bots[result.players[result.winner]].name);
+        return 0;
+    }
+
+    runJobs(matchCount, threadCount, playTournamentMatch, &tournament);
+
+    // Ratings are updated in match order, so they don't depend on threads.
+    int count = players.size();
+    std::vector<double> elo(count, 1500);
+    std::vector<int> wins(count), losses(count), draws(count);
+    FILE *resultsFile = resultsPath ? fopen(resultsPath, "w") : NULL;
+    if (resultsFile) {
+        fprintf(resultsFile, "match,seed,first,second,score1,score2,winner\n");
+    }
+
+    for (int m = 0; m < matchCount; m++) {
+        const MatchResult &result = tournament.results[m];
+        int first = result.seats[0];
+        int second = result.seats[1];
+
+        double outcome = result.winner < 0 ? 0.5 : result.winner == 0;
+        updateElo(elo[first], elo[second], outcome);
+        if (result.winner < 0) {
+            draws[first]++;
+            draws[second]++;
+        } else {
+            wins[result.winner == 0 ? first : second]++;
+            losses[result.winner == 0 ? second : first]++;
+        }
+
+        if (resultsFile) {
+            fprintf(resultsFile, "%d,%llu,%s,%s,%d,%d,%s\n", m,
+                    (unsigned long long)(seed + m),
+                    bots[result.players[0]].name, bots[result.players[1]].name,
+                    result.scores[0], result.scores[1],
+                    result.winner < 0
+                        ? "draw"
+                        : bots[result.players[result.winner]].name);
+        }
+    }
+    if (resultsFile) {
+        fclose(resultsFile);
+    }
+
+    printf("%-12s %6s %6s %6s %8s\n", "Bot", "Wins", "Losses", "Draws", "Elo");
+    for (int i = 0; i < count; i++) {
+        printf("%-12s %6d %6d %6d %8.1f\n", bots[players[i]].name, wins[i],
+               losses[i], draws[i], elo[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+#include "../include/tracing.h"
+
+/**
+ * Ring of events recorded by one thread.
+ */
+struct TraceBuffer {
+    TraceEvent events[traceCapacity];
+    uint64_t count; // Events recorded, including overwritten.
+    int threadId;
+    const char *phase; // Phase running on thread, NULL if none.
+    int64_t phaseStart;
+};
+
+// Buffers stay after their threads exit, so they can be written.
+static std::mutex buffersMutex;
+static std::vector<TraceBuffer *> buffers;
+static thread_local TraceBuffer *threadBuffer = NULL;
+
+/**
+ * Getting buffer of calling thread, creating it on first use.
+ */
+static TraceBuffer &getBuffer() {
+
+    if (!threadBuffer) {
+        threadBuffer = new TraceBuffer();
+        threadBuffer->count = 0;
+        threadBuffer->phase = NULL;
+        std::lock_guard<std::mutex> guard(buffersMutex);
+        threadBuffer->threadId = buffers.size();
+        buffers.push_back(threadBuffer);
+    }
+    return *threadBuffer;
+}
+
+/**
+ * Getting monotonic time for trace events.
+ *
+ * @return Nanoseconds since unspecified point.
+ */
+int64_t traceClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * Recording finished event on calling thread.
+ *
+ * @param name Static string shown in trace viewer.
+ * @param start, end Times from traceClock.
+ */
+void recordTrace(const char *name, int64_t start, int64_t end) {
+
+    TraceBuffer &buffer = getBuffer();
+    TraceEvent &event = buffer.events[buffer.count % traceCapacity];
+    event.name = name;
+    event.start = start;
+    event.duration = end - start;
+    buffer.count++;
+}
+
+/**
+ * Ending current phase of calling thread and starting next one.
+ *
+ * Used for consecutive sections of loop, which aren't scopes.
+ *
+ * @param name Next phase, NULL only ends current one.
+ */
+void tracePhase(const char *name) {
+
+    TraceBuffer &buffer = getBuffer();
+    int64_t now = traceClock();
+    if (buffer.phase) {
+        recordTrace(buffer.phase, buffer.phaseStart, now);
+    }
+    buffer.phase = name;
+    buffer.phaseStart = now;
+}
+
+TraceScope::TraceScope(const char *name) : name(name), start(traceClock()) {
+}
+
+TraceScope::~TraceScope() {
+    recordTrace(name, start, traceClock());
+}
+
+/**
+ * Writing events of all threads as Chrome trace_event JSON,
+ * which can be opened in chrome://tracing or Perfetto.
+ *
+ * @return False if file can't be written.
+ */
+bool writeTrace(const char *path) {
+
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"traceEvents\":[");
+    const char *separator = "\n";
+    std::lock_guard<std::mutex> guard(buffersMutex);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        const TraceBuffer &buffer = *buffers[i];
+        uint64_t first =
+            buffer.count > (uint64_t)traceCapacity ? buffer.count - traceCapacity : 0;
+        for (uint64_t j = first; j < buffer.count; j++) {
+            const TraceEvent &event = buffer.events[j % traceCapacity];
+            fprintf(file,
+                    "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%lld.%03lld,\"dur\":%lld.%03lld}",
+                    separator, event.name, buffer.threadId,
+                    (long long)(event.start / 1000),
+                    (long long)(event.start % 1000),
+                    (long long)(event.duration / 1000),
+                    (long long)(event.duration % 1000));
+            separator = ",\n";
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    return fclose(file) == 0;
+}
@@ -0,0 +1,102 @@
+#include <cstring>
+#include "../include/verify.h"
+
+// Press budget unit, one press is worth a second of refill.
+const int64_t pressCost = 1000000;
+
+/**
+ * Resetting checks for new game.
+ */
+void initVerifier(Verifier &verifier) {
+
+    verifier.lastTime = 0;
+    verifier.tokens = maxInputBurst * pressCost;
+    memset(verifier.verdicts, 0, sizeof(verifier.verdicts));
+}
+
+/**
+ * Checking input against human limits and applying it.
+ *
+ * Presses refill at maxInputRate per second of game time, so
+ * client can't gain by sending timestamps close together.
+ * Rejected input isn't applied. Accepted input is applied at its
+ * own time, so result doesn't depend on when it arrived.
+ *
+ * @param game Authoritative game, created with client seed and options
+ * and advanced only up to maxInputLag behind server clock, so inputs
+ * delayed less than that are never behind it.
+ * @param serverTime Microseconds since game start by server clock.
+ * @return One of verdict constants.
+ */
+int submitInput(Verifier &verifier, Game &game, const InputEvent &input,
+                int64_t serverTime) {
+
+    int verdict = inputAccepted;
+    int64_t tokens = verifier.tokens +
+                     (input.time - verifier.lastTime) * maxInputRate;
+    if (tokens > maxInputBurst * pressCost) {
+        tokens = maxInputBurst * pressCost;
+    }
+
+    if (input.key < 0 || input.key >= keyCount) {
+        verdict = inputInvalidKey;
+    } else if (input.time < verifier.lastTime) {
+        verdict = inputOutOfOrder;
+    } else if (input.time > serverTime + maxInputLead) {
+        verdict = inputFromFuture;
+    } else if (input.time < game.time) {
+        verdict = inputTooLate;
+    } else if (input.isPress && tokens < pressCost) {
+        verdict = inputTooFast;
+    }
+
+    verifier.verdicts[verdict]++;
+    if (verdict != inputAccepted) {
+        return verdict;
+    }
+
+    verifier.lastTime = input.time;
+    if (input.isPress) {
+        verifier.tokens = tokens - pressCost;
+        pressKey(game, input.key, input.time);
+    } else {
+        verifier.tokens = tokens;
+        releaseKey(game, input.key, input.time);
+    }
+    return verdict;
+}
+
+/**
+ * Counting inputs which weren't applied.
+ */
+int rejectedInputs(const Verifier &verifier) {
+
+    int count = 0;
+    for (int i = inputAccepted + 1; i < verdictCount; i++) {
+        count += verifier.verdicts[i];
+    }
+    return count;
+}
+
+/**
+ * Hashing state visible to players, FNV-1a over board,
+ * current piece and stats.
+ *
+ * Equal hashes of client and server game mean client
+ * shows authoritative state.
+ */
+uint64_t hashGame(const Game &game) {
+
+    uint64_t hash = 14695981039346656037ULL;
+    int values[] = {game.currentPiece, game.currentRotation, game.currentX,
+                    game.currentY,     game.holdPiece,       game.score,
+                    game.lines,        game.level,           game.isGameOver};
+
+    for (int y = 0; y < fieldHeight; y++) {
+        hash = (hash ^ game.board.rows[y]) * 1099511628211ULL;
+    }
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        hash = (hash ^ (uint32_t)values[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,100 @@
+#include "../include/functions.h"
+#include "../include/versus.h"
+
+/**
+ * Starting match.
+ *
+ * All players get the same pieces, holes in
+ * garbage are seeded separately for every player.
+ *
+ * @param players Number of players (1-4).
+ * @param options Rules of every game.
+ */
+void initMatch(Match &match, int players, const GameOptions &options) {
+
+    match.players = players;
+
+    for (int i = 0; i < players; i++) {
+        initGame(match.games[i], options);
+        match.holeRandom[i] = (options.seed + i + 1) * 0x9E3779B97F4A7C15ULL;
+        for (int j = 0; j < players; j++) {
+            initGarbageQueue(match.queues[i][j]);
+        }
+    }
+}
+
+/**
+ * Sending garbage of player to next player still in game.
+ */
+void sendGarbage(Match &match, int player) {
+
+    Game &game = match.games[player];
+
+    if (game.attack == 0) {
+        return;
+    }
+
+    for (int i = 1; i < match.players; i++) {
+        int target = (player + i) % match.players;
+        if (!match.games[target].isGameOver) {
+            GarbageAttack attack;
+            attack.lines = game.attack;
+            attack.hole = 1 + randomBelow(match.holeRandom[player],
+                                          fieldWidth - 2);
+            pushGarbage(match.queues[player][target], attack);
+            break;
+        }
+    }
+
+    game.attack = 0;
+}
+
+/**
+ * Adding all garbage sent to player to its field.
+ */
+void receiveGarbage(Match &match, int player) {
+
+    GarbageAttack attack;
+
+    for (int i = 0; i < match.players; i++) {
+        while (popGarbage(match.queues[i][player], attack)) {
+            addGarbage(match.games[player], attack.lines, attack.hole);
+        }
+    }
+}
+
+/**
+ * Counting players still in game.
+ */
+int playersLeft(const Match &match) {
+
+    int count = 0;
+
+    for (int i = 0; i < match.players; i++) {
+        count += !match.games[i].isGameOver;
+    }
+
+    return count;
+}
+
+/**
+ * Finding winner of match.
+ *
+ * @return Index of last player in game, -1 if there
+ *   are still several players or nobody in game.
+ */
+int matchWinner(const Match &match) {
+
+    int winner = -1;
+
+    for (int i = 0; i < match.players; i++) {
+        if (!match.games[i].isGameOver) {
+            if (winner >= 0) {
+                return -1;
+            }
+            winner = i;
+        }
+    }
+
+    return winner;
+}
@@ -1,7 +1,33 @@
 #define CATCH_CONFIG_MAIN  // Provide main().
+#include <fstream>
+#include <sstream>
+#include <thread>
 #include "../lib/catch.hpp"
 #include "../include/functions.h"
 #include "../include/globals.h"
+#include "../include/engine.h"
+#include "../include/scoring.h"
+#include "../include/versus.h"
+#include "../include/bot.h"
+#include "../include/scheduler.h"
+#include "../include/terminal.h"
+#include "../include/timerwheel.h"
+#include "../include/verify.h"
+#include "../include/rollback.h"
+#include "../include/tracing.h"
+#include "../include/counters.h"
+#include "../include/histogram.h"
+#include "../include/baseline.h"
+#include "../include/corpus.h"
+#include "../include/fuzz.h"
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../include/handoff.h"
+#include "../include/server.h"
+#include "../include/spectator.h"
+#endif
 
 TEST_CASE( "Tetromino pixel rotation function", "[rotate]" ) {
     REQUIRE( rotate(0, 0, 0) == 0 );
@@ -21,3 +47,994 @@ TEST_CASE( "Custom power function for integers", "[power]" ) {
     REQUIRE( power(2, 5) == 32 );
     REQUIRE( power(1, 10) == 1 );
 }
+
+TEST_CASE( "Tetromino mask rotation function", "[rotateTetrominoMask]" ) {
+    REQUIRE( tetrominoMask(tetromino[0]) == 0x4444 );
+    REQUIRE( rotateTetrominoMask(0x4444, 1) == 0x0F00 );
+
+    uint16_t masks[tetrominoCount][rotationCount];
+    rotateAllTetrominoes(masks);
+
+    for (int i = 0; i < tetrominoCount; i++) {
+        for (int r = 0; r < rotationCount; r++) {
+            REQUIRE( masks[i][r] ==
+                     tetrominoMask(rotateTetromino(tetromino[i], r)) );
+        }
+    }
+}
+
+TEST_CASE( "Precomputed tetromino masks", "[pieceMasks]" ) {
+    uint16_t masks[tetrominoCount][rotationCount];
+    rotateAllTetrominoes(masks);
+
+    for (int i = 0; i < tetrominoCount; i++) {
+        for (int r = 0; r < rotationCount; r++) {
+            REQUIRE( pieceMasks[i][r] == masks[i][r] );
+        }
+    }
+}
+
+TEST_CASE( "Bitboard collision and line removal", "[bitboard]" ) {
+    Board board;
+    initBoard(board);
+
+    // I piece standing at the left wall.
+    REQUIRE( pieceFits(board, 0, 0, -1, 0) );
+    REQUIRE_FALSE( pieceFits(board, 0, 0, -2, 0) );
+    REQUIRE_FALSE( pieceFits(board, 0, 0, 4, fieldHeight - 4) );
+
+    // Fill bottom row except one cell and drop I piece into the gap.
+    for (int x = 1; x < fieldWidth - 2; x++) {
+        board.rows[fieldHeight - 2] |= 1 << x;
+        board.field[(fieldHeight - 2) * fieldWidth + x] = 1;
+    }
+    lockPiece(board, 0, 0, fieldWidth - 4, fieldHeight - 5);
+
+    int lines[tetrominoWidth];
+    REQUIRE( findLines(board, fieldHeight - 5, lines) == 1 );
+    REQUIRE( lines[0] == fieldHeight - 2 );
+
+    removeLines(board, lines, 1);
+    REQUIRE( board.rows[fieldHeight - 2] == (wallRow | 1 << (fieldWidth - 2)) );
+    REQUIRE( board.field[(fieldHeight - 2) * fieldWidth + fieldWidth - 2] == 1 );
+    REQUIRE( board.rows[0] == wallRow );
+}
+
+TEST_CASE( "Super Rotation System wall kicks", "[srs]" ) {
+    Game game;
+    GameOptions options;
+
+    // I piece against the right wall can rotate only with kicks.
+    initGame(game, options);
+    game.currentPiece = 0;
+    game.currentX = fieldWidth - 4;
+    game.currentY = 5;
+    REQUIRE_FALSE( rotatePiece(game, 1) );
+
+    options.useSrs = true;
+    initGame(game, options);
+    game.currentPiece = 0;
+    game.currentX = fieldWidth - 4;
+    game.currentY = 5;
+    REQUIRE( rotatePiece(game, 1) );
+    REQUIRE( game.currentRotation == 1 );
+    REQUIRE( game.currentX == fieldWidth - 6 );
+
+    REQUIRE( rotatePiece(game, -1) );
+    REQUIRE( game.currentRotation == 0 );
+}
+
+TEST_CASE( "T-spin detection with corner masks", "[spin]" ) {
+    GameOptions options;
+    options.spinMode = spinModeT;
+
+    Game game;
+    initGame(game, options);
+
+    // T-spin double slot with overhang at the top left corner.
+    Board &board = game.board;
+    for (int x = 1; x < fieldWidth - 1; x++) {
+        if (x != 4) {
+            board.rows[fieldHeight - 2] |= 1 << x;
+        }
+        if (x < 3 || x > 5) {
+            board.rows[fieldHeight - 3] |= 1 << x;
+        }
+    }
+    board.rows[fieldHeight - 4] |= 1 << 3;
+
+    int posY = fieldHeight - 4;
+    REQUIRE( detectSpin(board, spinModeT, tetrominoT, 3, 3, posY, 0) == spinFull );
+    REQUIRE( detectSpin(board, spinModeT, tetrominoT, 3, 3, posY, -1) == spinNone );
+    REQUIRE( detectSpin(board, spinModeOff, tetrominoT, 3, 3, posY, 0) == spinNone );
+
+    // Locking it scores the spin on top of two lines.
+    game.currentPiece = tetrominoT;
+    game.currentRotation = 3;
+    game.currentX = 3;
+    game.currentY = posY;
+    game.lastKick = 0;
+    game.gravityCounter = gravityUnit - game.gravity;
+    tickGame(game);
+
+    REQUIRE( game.lastSpin == spinFull );
+    REQUIRE( game.score == 25 + 400 + 1200 );
+}
+
+TEST_CASE( "Scoring and leveling rulesets", "[scoring]" ) {
+    GameOptions options;
+    Game game;
+
+    // Default rules match original scoring.
+    initGame(game, options);
+    updateScore(game, 0, false);
+    updateScore(game, 3, false);
+    REQUIRE( game.score == 25 + 25 + 900 );
+    game.pieceCount = 42;
+    updateLevel(game);
+    REQUIRE( game.level == 3 );
+    REQUIRE( game.gravity == gravityUnit / 5 );
+
+    // Guideline back-to-back tetrises with combo.
+    options.ruleset = findRuleset("guideline");
+    initGame(game, options);
+    updateScore(game, 4, false);
+    updateScore(game, 4, false);
+    REQUIRE( game.score == 800 + 1200 + 50 );
+    updateScore(game, 1, true);
+    REQUIRE( game.backToBack == false );
+    REQUIRE( game.score == 2050 + 100 + 100 + 800 );
+    REQUIRE( game.lines == 9 );
+    updateScore(game, 1, false);
+    updateLevel(game);
+    REQUIRE( game.level == 1 );
+
+    // Guideline level stops at 15, gravity reaches 20G at 18.
+    game.lines = 180;
+    updateLevel(game);
+    REQUIRE( game.level == 15 );
+    REQUIRE( game.gravity == gravity20G );
+
+    REQUIRE( findRuleset("nes") == rulesNes );
+    REQUIRE( findRuleset("unknown") == -1 );
+}
+
+TEST_CASE( "Piece queue and hold", "[preview]" ) {
+    PieceQueue queue, same;
+    initQueue(queue, 42, true);
+    initQueue(same, 42, true);
+
+    // Every bag has all tetrominoes, same seed gives same pieces.
+    for (int bag = 0; bag < 5; bag++) {
+        int seen = 0;
+        for (int i = 0; i < tetrominoCount; i++) {
+            REQUIRE( peekPiece(queue, maxPreviewDepth - 1) ==
+                     peekPiece(same, maxPreviewDepth - 1) );
+            seen |= 1 << popPiece(queue);
+            popPiece(same);
+        }
+        REQUIRE( seen == (1 << tetrominoCount) - 1 );
+    }
+
+    GameOptions options;
+    Game game;
+    initGame(game, options);
+
+    int first = game.currentPiece;
+    int next = peekPiece(game.queue, 0);
+    REQUIRE( holdCurrentPiece(game) );
+    REQUIRE( game.holdPiece == first );
+    REQUIRE( game.currentPiece == next );
+    REQUIRE_FALSE( holdCurrentPiece(game) );
+}
+
+TEST_CASE( "Auto shift and lock delay timing", "[timing]" ) {
+    GameOptions options;
+    Game game;
+
+    // Default gravity moves piece every 20 ticks of 25 ms.
+    initGame(game, options);
+    int y = game.currentY;
+    advanceGame(game, 20 * 25000 - 1);
+    REQUIRE( game.currentY == y );
+    advanceGame(game, 20 * 25000);
+    REQUIRE( game.currentY == y + 1 );
+
+    // Auto shift starts after DAS and repeats every ARR.
+    options.dasTime = 100000;
+    options.arrTime = 20000;
+    initGame(game, options);
+    int x = game.currentX;
+    pressKey(game, keyLeft, 1000);
+    pressKey(game, keyLeft, 50000); // Terminal repeat is ignored.
+    REQUIRE( game.currentX == x - 1 );
+    advanceGame(game, 101000);
+    REQUIRE( game.currentX == x - 2 );
+    releaseKey(game, keyLeft, 121000);
+    REQUIRE( game.currentX == x - 3 );
+    advanceGame(game, 200000);
+    REQUIRE( game.currentX == x - 3 );
+
+    // Zero ARR moves piece to the wall at once.
+    options.arrTime = 0;
+    initGame(game, options);
+    pressKey(game, keyRight, 0);
+    advanceGame(game, 100000);
+    REQUIRE_FALSE( movePiece(game, 1, 0) );
+
+    // Grounded piece locks only after lock delay.
+    options.lockDelay = 500000;
+    initGame(game, options);
+    game.currentRotation = 1;
+    while (movePiece(game, 0, 1)) {
+    }
+    REQUIRE( game.lockTime == 500000 );
+    advanceGame(game, 499999);
+    REQUIRE( game.pieceCount == 0 );
+    advanceGame(game, 500000);
+    REQUIRE( game.pieceCount == 1 );
+}
+
+TEST_CASE( "Gravity accumulator and landing row", "[gravity]" ) {
+    GameOptions options;
+    Game game;
+
+    // Landing row matches moving piece down cell by cell.
+    initGame(game, options);
+    lockPiece(game.board, 0, 0, 4, fieldHeight - 5);
+    for (int i = 0; i < tetrominoCount; i++) {
+        for (int r = 0; r < rotationCount; r++) {
+            for (int x = -1; x < fieldWidth - 1; x++) {
+                if (!pieceFits(game.board, i, r, x, 0)) {
+                    continue;
+                }
+                int y = 0;
+                while (y < fieldHeight &&
+                       pieceFits(game.board, i, r, x, y + 1)) {
+                    y++;
+                }
+                REQUIRE( dropDistance(game.board, i, r, x, 0) == y );
+            }
+        }
+    }
+
+    // Half a cell per tick.
+    initGame(game, options);
+    game.gravity = gravityUnit / 2;
+    int y = game.currentY;
+    tickGame(game);
+    REQUIRE( game.currentY == y );
+    tickGame(game);
+    REQUIRE( game.currentY == y + 1 );
+
+    // 20G drops piece to the floor at the first tick.
+    options.gravity20G = true;
+    options.lockDelay = 500000;
+    initGame(game, options);
+    tickGame(game);
+    REQUIRE( dropDistance(game.board, game.currentPiece,
+                          game.currentRotation, game.currentX,
+                          game.currentY) == 0 );
+    REQUIRE( game.lockTime >= 0 );
+    REQUIRE( game.pieceCount == 0 );
+}
+
+TEST_CASE( "Garbage insertion and exchange", "[versus]" ) {
+    Board board;
+    initBoard(board);
+    lockPiece(board, 2, 0, 4, fieldHeight - 4);
+
+    insertGarbage(board, 2, 3);
+    REQUIRE( board.rows[fieldHeight - 2] == (fullRow & ~(1 << 3)) );
+    REQUIRE( board.rows[fieldHeight - 4] == (wallRow | 0x60) );
+    REQUIRE( board.field[(fieldHeight - 2) * fieldWidth + 3] == 0 );
+    REQUIRE( board.cols[3] == (1u << (fieldHeight - 1)) );
+    REQUIRE( board.cols[5] == (0x1Fu << (fieldHeight - 5)) );
+    REQUIRE( board.cells == 4 + 2 * (fieldWidth - 3) );
+
+    GarbageQueue queue;
+    initGarbageQueue(queue);
+    GarbageAttack attack = {2, 5};
+    for (int i = 0; i < garbageQueueSize; i++) {
+        REQUIRE( pushGarbage(queue, attack) );
+    }
+    REQUIRE_FALSE( pushGarbage(queue, attack) );
+    REQUIRE( popGarbage(queue, attack) );
+    REQUIRE( attack.lines == 2 );
+
+    // Tetris sends four lines to the opponent.
+    GameOptions options;
+    Match match;
+    initMatch(match, 2, options);
+    match.games[0].attack = 4;
+    sendGarbage(match, 0);
+    receiveGarbage(match, 1);
+    REQUIRE( match.games[1].board.cells == 4 * (fieldWidth - 3) );
+    REQUIRE( match.games[0].attack == 0 );
+    REQUIRE( matchWinner(match) == -1 );
+
+    match.games[0].isGameOver = true;
+    REQUIRE( playersLeft(match) == 1 );
+    REQUIRE( matchWinner(match) == 1 );
+}
+
+TEST_CASE( "Placements and bot matches", "[bot]" ) {
+    Board board;
+    initBoard(board);
+
+    // O has 9 columns, I has 7 horizontal and 10 vertical placements.
+    Placement placements[maxPlacements];
+    REQUIRE( findPlacements(board, 2, placements) == 9 );
+    REQUIRE( findPlacements(board, 0, placements) == 17 );
+    REQUIRE( placements[0].y == fieldHeight - 5 );
+
+    // Same seed gives same match.
+    int players[2] = {findBot("heuristic"), findBot("random")};
+    int scores[2], again[2];
+    int winner = playMatch(players, 2, 7, 1000, scores);
+    REQUIRE( playMatch(players, 2, 7, 1000, again) == winner );
+    REQUIRE( scores[0] == again[0] );
+    REQUIRE( scores[1] == again[1] );
+    REQUIRE( winner == 0 );
+}
+
+TEST_CASE( "Perft counts placement sequences", "[perft]" ) {
+    Board board;
+    initBoard(board);
+
+    // Empty board: I 17, T 34, O 9, Z 17, nothing blocks.
+    int pieces[4] = {0, 1, 2, 3};
+    uint64_t counts[5] = {1, 17, 578, 5202, 88434};
+    for (int depth = 0; depth <= 4; depth++) {
+        REQUIRE( perft(board, pieces, depth) == counts[depth] );
+    }
+
+    // Garbage with spread holes, lines are cleared and stacks
+    // block some placements.
+    for (int i = 0; i < 9; i++) {
+        insertGarbage(board, 1, 1 + i * 7 % (fieldWidth - 2));
+    }
+    int lines[4] = {0, 6, 5, 0};
+    REQUIRE( perft(board, lines, 4) == 300603 );
+    for (int i = 0; i < 7; i++) {
+        insertGarbage(board, 1, 1 + i * 7 % (fieldWidth - 2));
+    }
+    REQUIRE( perft(board, pieces + 2, 1) == 0 );
+}
+
+TEST_CASE( "Engine plays the same as reference game", "[baseline]" ) {
+    std::string difference;
+
+    // Dropping every piece fills the middle, games end together.
+    std::vector<int8_t> drops(4000, keyDown);
+    REQUIRE( findDivergence(1, drops, difference) == noDivergence );
+    ReferenceGame original;
+    initReferenceGame(original, 1);
+    for (int i = 0; i < 4000; i++) {
+        tickReferenceGame(original, keyDown);
+    }
+    REQUIRE( original.isGameOver );
+
+    // Random keys, every kind in every game. Some games end by
+    // spawning over locked cells, where only engine ends them.
+    uint64_t state = 12345;
+    int knownDifferences = 0;
+    for (int game = 0; game < 200; game++) {
+        std::vector<int8_t> keys(1000, -1);
+        for (int i = 0; i < 1000; i++) {
+            if (randomBelow(state, 3) == 0) {
+                keys[i] = randomBelow(state, keyRotateRight + 1);
+            }
+        }
+        int tick = findDivergence(game + 1, keys, difference);
+        REQUIRE( (tick == noDivergence || tick == knownSpawnDifference) );
+        knownDifferences += tick == knownSpawnDifference;
+    }
+    REQUIRE( knownDifferences > 0 );
+}
+
+TEST_CASE( "Golden games replay identically", "[corpus]" ) {
+    const char *paths[] = {"test/corpus/project.txt", "test/corpus/nes.txt",
+                           "test/corpus/guideline.txt"};
+    std::string difference;
+
+    for (const char *path : paths) {
+        std::vector<GoldenGame> games;
+        REQUIRE( readGoldenGames(path, games) );
+        REQUIRE( games.size() > 0 );
+        INFO( path << ": " << difference );
+        REQUIRE( checkGoldenGames(games, 4, difference) == -1 );
+
+        // Changed outcome is found at its piece.
+        games[1].hashes[0] ^= 1;
+        REQUIRE( checkGoldenGames(games, 4, difference) == 1 );
+        REQUIRE( difference.find("piece 1:") == 0 );
+    }
+
+    // Written games are read back the same.
+    std::vector<GoldenGame> games(1);
+    uint64_t random = 1;
+    GameOptions options;
+    options.dasTime = 150000;
+    recordGoldenGame(games[0], options, 20, random);
+    REQUIRE( games[0].hashes.size() > 0 );
+    REQUIRE( writeGoldenGames("bin/golden-test.txt", games) );
+    std::vector<GoldenGame> read;
+    REQUIRE( readGoldenGames("bin/golden-test.txt", read) );
+    REQUIRE( read.size() == 1 );
+    REQUIRE( read[0].inputs.size() == games[0].inputs.size() );
+    REQUIRE( read[0].hashes == games[0].hashes );
+    REQUIRE( checkGoldenGame(read[0], difference) );
+    remove("bin/golden-test.txt");
+}
+
+TEST_CASE( "Fuzzed games keep invariants", "[fuzz]" ) {
+    std::string problem;
+
+    // Empty input lets pieces fall with default rules.
+    REQUIRE( fuzzGame(NULL, 0, problem) );
+
+    // Random bytes, as standalone fuzz driver makes them.
+    uint64_t state = 99;
+    std::vector<uint8_t> data;
+    for (int run = 0; run < 2000; run++) {
+        data.resize(randomBelow(state, 256));
+        for (size_t i = 0; i < data.size(); i++) {
+            data[i] = randomBelow(state, 256);
+        }
+        INFO( "run " << run << ": " << problem );
+        REQUIRE( fuzzGame(data.data(), data.size(), problem) );
+    }
+
+    // Broken board is noticed.
+    Game game;
+    GameOptions options;
+    initGame(game, options);
+    REQUIRE( checkGameInvariants(game, problem) );
+    game.board.field[fieldWidth + 3] = 2;
+    REQUIRE_FALSE( checkGameInvariants(game, problem) );
+}
+
+TEST_CASE( "Pieces neither spawn into cells nor pass walls above field", "[engine]" ) {
+    // Piece can't spawn over cell locked at the top, even if
+    // it could move down, as original game let it.
+    Game game;
+    GameOptions options;
+    initGame(game, options);
+    int piece = peekPiece(game.queue, 0);
+    int pixel = __builtin_ctz(pieceMasks[piece][0]);
+    int x = fieldWidth / 2 + pixel % tetrominoWidth;
+    int y = pixel / tetrominoWidth;
+    game.board.field[y * fieldWidth + x] = 1;
+    game.board.rows[y] |= 1 << x;
+    game.board.cols[x] |= 1u << y;
+    game.board.cells++;
+    REQUIRE( pieceFits(game.board, piece, 0, fieldWidth / 2, 1) );
+    holdCurrentPiece(game);
+    REQUIRE( game.isGameOver );
+
+    // Walls stop pieces above the field and kicks past them.
+    Board board;
+    initBoard(board);
+    REQUIRE( pieceFits(board, 0, 1, 7, -3) );
+    REQUIRE_FALSE( pieceFits(board, 0, 1, 8, -3) );
+    REQUIRE( pieceFits(board, 0, 0, -1, 5) );
+    REQUIRE_FALSE( pieceFits(board, 0, 0, -3, 5) );
+}
+
+static void countJob(int index, int worker, void *context) {
+    ((std::atomic<int> *)context)[index]++;
+}
+
+TEST_CASE( "Work stealing scheduler runs every job once", "[scheduler]" ) {
+    std::atomic<int> counts[1000];
+    for (int i = 0; i < 1000; i++) {
+        counts[i] = 0;
+    }
+
+    runJobs(1000, 4, countJob, counts);
+
+    for (int i = 0; i < 1000; i++) {
+        REQUIRE( counts[i] == 1 );
+    }
+}
+
+TEST_CASE( "ANSI frame difference", "[terminal]" ) {
+    Game game;
+    initGame(game, GameOptions());
+    Frame first, second;
+    drawGame(game, first);
+    drawGame(game, second);
+
+    std::string out;
+    renderFrame(NULL, first, out);
+    REQUIRE( out.find("\x1b[2J") != std::string::npos );
+
+    // Same frames give no output, changed run is written after cursor move.
+    out.clear();
+    renderFrame(&first, second, out);
+    REQUIRE( out.empty() );
+
+    second.cells[2][4] = 'X';
+    second.cells[2][5] = 'Y';
+    renderFrame(&first, second, out);
+    REQUIRE( out == "\x1b[3;5HXY" );
+}
+
+TEST_CASE( "Timing wheel expires timers in batches", "[timerwheel]" ) {
+    static TimerWheel wheel;
+    initWheel(wheel, 1000, 0);
+
+    // Timers on every level, one of them cancelled.
+    int64_t dues[5] = {2500, 2100, 70000, 5000000, 400000000};
+    TimerNode timers[5];
+    for (int i = 0; i < 5; i++) {
+        initTimerNode(timers[i]);
+        scheduleTimer(wheel, timers[i], dues[i]);
+    }
+    cancelTimer(timers[3]);
+
+    TimerNode expired;
+    initTimerNode(expired);
+    expireTimers(wheel, 2999, expired);
+    REQUIRE( popTimer(expired) == NULL );
+    expireTimers(wheel, 3000, expired);
+    REQUIRE( popTimer(expired) == &timers[0] );
+    REQUIRE( popTimer(expired) == &timers[1] );
+    REQUIRE( popTimer(expired) == NULL );
+
+    expireTimers(wheel, 69999, expired);
+    REQUIRE( popTimer(expired) == NULL );
+    expireTimers(wheel, 70000, expired);
+    REQUIRE( popTimer(expired) == &timers[2] );
+
+    expireTimers(wheel, 399999999, expired);
+    REQUIRE( popTimer(expired) == NULL );
+    expireTimers(wheel, 400000500, expired);
+    REQUIRE( popTimer(expired) == &timers[4] );
+
+    // Timers are never early, up to one slot late.
+    REQUIRE( wheel.lateness.total == 4 );
+    REQUIRE( latenessPercentile(wheel.lateness, 50) == 511 );
+    REQUIRE( latenessPercentile(wheel.lateness, 100) == 1023 );
+}
+
+TEST_CASE( "Inputs are verified by re-simulation", "[verify]" ) {
+    GameOptions options;
+    options.seed = 5;
+    options.dasTime = 100000;
+    Game client, authority;
+    initGame(client, options);
+    initGame(authority, options);
+    Verifier verifier;
+    initVerifier(verifier);
+
+    // Same accepted inputs give same state.
+    InputEvent inputs[] = {{40000, keyRotateRight, true},
+                           {90000, keyLeft, true},
+                           {400000, keyLeft, false},
+                           {500000, keyHold, true},
+                           {520000, keyDown, true},
+                           {1000000, keyDown, false}};
+    for (int i = 0; i < 6; i++) {
+        if (inputs[i].isPress) {
+            pressKey(client, inputs[i].key, inputs[i].time);
+        } else {
+            releaseKey(client, inputs[i].key, inputs[i].time);
+        }
+        REQUIRE( submitInput(verifier, authority, inputs[i], 1000000) ==
+                 inputAccepted );
+    }
+    advanceGame(client, 1200000);
+    advanceGame(authority, 1200000);
+    REQUIRE( hashGame(client) == hashGame(authority) );
+    REQUIRE( client.currentX != fieldWidth / 2 - 2 );
+
+    // Impossible inputs are rejected and not applied.
+    InputEvent early = {900000, keyLeft, true};
+    InputEvent ahead = {2000000, keyLeft, true};
+    InputEvent late = {1300000, keyCount, true};
+    REQUIRE( submitInput(verifier, authority, early, 1200000) == inputOutOfOrder );
+    REQUIRE( submitInput(verifier, authority, ahead, 1200000) == inputFromFuture );
+    REQUIRE( submitInput(verifier, authority, late, 1300000) == inputInvalidKey );
+    InputEvent behind = {1100000, keyLeft, true};
+    REQUIRE( submitInput(verifier, authority, behind, 1300000) == inputTooLate );
+    REQUIRE( hashGame(client) == hashGame(authority) );
+
+    int accepted = 0;
+    for (int i = 0; i < 40; i++) {
+        InputEvent press = {1300000 + i * 1000, keyRotateRight, true};
+        accepted += submitInput(verifier, authority, press, 1400000) ==
+                    inputAccepted;
+    }
+    REQUIRE( accepted == maxInputBurst + 1 );
+    REQUIRE( verifier.verdicts[inputTooFast] == 40 - accepted );
+}
+
+TEST_CASE( "Rollback peers agree over delayed loopback", "[rollback]" ) {
+    GameOptions options;
+    options.seed = 11;
+    options.useBag = true;
+    options.dasTime = 150000;
+
+    int latencies[3][2] = {{0, 0}, {2, 3}, {6, 4}};
+    for (int i = 0; i < 3; i++) {
+        LoopbackTest test = {};
+        test.ticks = 2000;
+        test.latency = latencies[i][0];
+        test.jitter = latencies[i][1];
+        test.seed = 3 + i;
+        runLoopback(test, options);
+
+        for (int peer = 0; peer < 2; peer++) {
+            REQUIRE( test.hashes[peer][0] == test.expected[0] );
+            REQUIRE( test.hashes[peer][1] == test.expected[1] );
+        }
+        if (test.latency > 0) {
+            REQUIRE( test.rollbacks > 0 );
+            REQUIRE( test.resimulatedTicks >= test.rollbacks );
+        }
+    }
+}
+
+TEST_CASE( "Phase trace is written as Chrome JSON", "[tracing]" ) {
+    tracePhase("timing");
+    {
+        TraceScope scope("scope");
+        tracePhase("logic");
+    }
+    tracePhase(NULL);
+
+    // Ring of other thread keeps only newest events.
+    std::thread worker([]() {
+        for (int64_t i = 0; i < traceCapacity + 5; i++) {
+            recordTrace("wrapped", i * 1000, i * 1000 + 500);
+        }
+    });
+    worker.join();
+
+    const char *path = "bin/trace-test.json";
+    REQUIRE( writeTrace(path) );
+    std::ifstream file(path);
+    std::stringstream json;
+    json << file.rdbuf();
+    std::string text = json.str();
+    REQUIRE( text.compare(0, 15, "{\"traceEvents\":") == 0 );
+    REQUIRE( text.find("\"name\":\"timing\"") != std::string::npos );
+    REQUIRE( text.find("\"name\":\"logic\"") != std::string::npos );
+    REQUIRE( text.find("\"name\":\"scope\"") != std::string::npos );
+
+    size_t first = text.find("\"name\":\"wrapped\"");
+    std::string oldest = "\"ts\":5.000,\"dur\":0.500";
+    REQUIRE( text.compare(text.find("\"ts\":", first), oldest.size(), oldest) == 0 );
+    int count = 0;
+    for (size_t i = text.find("\"wrapped\""); i != std::string::npos;
+         i = text.find("\"wrapped\"", i + 1)) {
+        count++;
+    }
+    REQUIRE( count == traceCapacity );
+    remove(path);
+}
+
+TEST_CASE( "Counters are summed over threads", "[counters]" ) {
+    registerCounters();
+    uint64_t before[counterCount];
+    sumCounters(before);
+
+    Board board;
+    initBoard(board);
+    pieceFits(board, 0, 0, 3, 0);
+    countEvent(counterInputEvents, 2);
+
+    // Exited thread still counts, unregistered one doesn't.
+    std::thread worker([]() {
+        registerCounters();
+        countEvent(counterBytesEmitted, 100);
+    });
+    worker.join();
+    std::thread hidden([]() { countEvent(counterBytesEmitted, 7); });
+    hidden.join();
+
+    uint64_t after[counterCount];
+    sumCounters(after);
+    REQUIRE( after[counterCollisionChecks] - before[counterCollisionChecks] == 1 );
+    REQUIRE( after[counterInputEvents] - before[counterInputEvents] == 2 );
+    REQUIRE( after[counterBytesEmitted] - before[counterBytesEmitted] == 100 );
+}
+
+TEST_CASE( "Engine instrumentation beyond collision checks is profiling only", "[counters]" ) {
+    registerCounters();
+    uint64_t before[counterCount];
+    sumCounters(before);
+
+    GameOptions options;
+    Game game;
+    initGame(game, options);
+    rotatePiece(game, 1);
+    dropPiece(game);
+
+    uint64_t after[counterCount];
+    sumCounters(after);
+    // Collision checks are counted in every build for --stats.
+    REQUIRE( after[counterCollisionChecks] > before[counterCollisionChecks] );
+#ifdef PROFILING
+    REQUIRE( after[counterRotations] - before[counterRotations] == 1 );
+    REQUIRE( after[counterLocks] - before[counterLocks] == 1 );
+#else
+    REQUIRE( after[counterRotations] == before[counterRotations] );
+    REQUIRE( after[counterLocks] == before[counterLocks] );
+    REQUIRE( after[counterLinesCleared] == before[counterLinesCleared] );
+#endif
+}
+
+TEST_CASE( "Histogram percentiles within bucket precision", "[histogram]" ) {
+    Histogram values;
+    initHistogram(values);
+    REQUIRE( valuePercentile(values, 50) == 0 );
+
+    for (int64_t i = 1; i <= 100000; i++) {
+        recordValue(values, i);
+    }
+    REQUIRE( values.total == 100000 );
+    REQUIRE( values.max == 100000 );
+    REQUIRE( valuePercentile(values, 100) == 100000 );
+    int64_t percentiles[3] = {50, 90, 99};
+    for (int i = 0; i < 3; i++) {
+        int64_t value = valuePercentile(values, percentiles[i]);
+        REQUIRE( value >= percentiles[i] * 1000 );
+        REQUIRE( value <= percentiles[i] * 1000 * 33 / 32 );
+    }
+
+    // Small values are exact.
+    Histogram small;
+    initHistogram(small);
+    for (int i = 0; i < 10; i++) {
+        recordValue(small, i % 5);
+    }
+    REQUIRE( valuePercentile(small, 50) == 2 );
+    REQUIRE( valuePercentile(small, 80) == 3 );
+}
+
+#ifdef __linux__
+/**
+ * Connecting test client to server port on localhost.
+ */
+static int connectLocal(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE( connect(fd, (sockaddr *)&address, sizeof(address)) == 0 );
+    return fd;
+}
+
+/**
+ * Reading from test client until text arrives.
+ */
+static std::string receiveUntil(int fd, const char *text) {
+    std::string received;
+    char buffer[4096];
+    while (received.find(text) == std::string::npos) {
+        ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+        REQUIRE( count > 0 );
+        received.append(buffer, count);
+    }
+    return received;
+}
+
+TEST_CASE( "Server plays sessions over localhost", "[server]" ) {
+    ServerOptions options;
+    options.port = 0;
+    Server gameServer;
+    REQUIRE( startServer(gameServer, options) );
+
+    int clients[8];
+    for (int i = 0; i < 8; i++) {
+        clients[i] = connectLocal(gameServer.port);
+    }
+
+    // Every client gets full frame first.
+    std::string frame = receiveUntil(clients[0], "Level: ");
+    REQUIRE( frame.compare(0, 10, "\x1b[?25l\x1b[2J") == 0 );
+    REQUIRE( frame.find("Score: 0") != std::string::npos );
+
+    // Q ends session, other sessions keep running.
+    REQUIRE( send(clients[0], "aQ", 2, 0) == 2 );
+    char buffer[4096];
+    ssize_t count;
+    while ((count = recv(clients[0], buffer, sizeof(buffer), 0)) > 0) {
+    }
+    REQUIRE( count == 0 );
+    while (serverSessions(gameServer) != 7) {
+        usleep(1000);
+    }
+
+    stopServer(gameServer);
+    for (int i = 0; i < 8; i++) {
+        close(clients[i]);
+    }
+}
+
+TEST_CASE( "Shared frames fan out to spectators", "[spectator]" ) {
+    int pairs[2][2];
+    Spectator viewers[2];
+    std::vector<Spectator *> list;
+    for (int i = 0; i < 2; i++) {
+        REQUIRE( socketpair(AF_UNIX, SOCK_STREAM, 0, pairs[i]) == 0 );
+        viewers[i].fd = pairs[i][0];
+        viewers[i].offset = 0;
+        list.push_back(&viewers[i]);
+    }
+
+    // One buffer is queued for both, freed when both sent it.
+    publishFrame(list, "first ");
+    publishFrame(list, "second");
+    REQUIRE( viewers[0].frames[0] == viewers[1].frames[0] );
+    REQUIRE( viewers[0].frames[0]->refs == 2 );
+
+    for (int i = 0; i < 2; i++) {
+        REQUIRE( flushSpectator(viewers[i]) == 1 );
+        REQUIRE( viewers[i].frames.empty() );
+        char buffer[32] = {};
+        REQUIRE( recv(pairs[i][1], buffer, sizeof(buffer), 0) == 12 );
+        REQUIRE( std::string(buffer) == "first second" );
+    }
+
+    // Partly sent frame is finished before keyframe replacing the rest.
+    publishFrame(list, "partly");
+    publishFrame(list, "skipped");
+    viewers[0].offset = 2;
+    dropUnsentFrames(viewers[0]);
+    dropUnsentFrames(viewers[1]);
+    REQUIRE( viewers[0].frames.size() == 1 );
+    REQUIRE( viewers[0].offset == 2 );
+    REQUIRE( viewers[1].frames.empty() );
+    queueFrame(viewers[0], createSharedFrame("key", 1));
+    REQUIRE( flushSpectator(viewers[0]) == 1 );
+    char buffer[32] = {};
+    REQUIRE( recv(pairs[0][1], buffer, sizeof(buffer), 0) == 7 );
+    REQUIRE( std::string(buffer) == "rtlykey" );
+
+    for (int i = 0; i < 2; i++) {
+        close(pairs[i][0]);
+        close(pairs[i][1]);
+    }
+}
+
+TEST_CASE( "Spectators get keyframe and deltas", "[spectator]" ) {
+    ServerOptions options;
+    options.port = -1;
+    options.spectatorPort = 0;
+    options.simulated = 1;
+    Server gameServer;
+    REQUIRE( startServer(gameServer, options) );
+
+    int first = connectLocal(gameServer.spectatorPort);
+    receiveUntil(first, "Games: 0\r\n");
+    REQUIRE( send(first, "0\r", 2, 0) == 2 );
+    std::string frames = receiveUntil(first, "Level: ");
+    REQUIRE( frames.find("\x1b[2J") != std::string::npos );
+
+    // Late joiner starts with keyframe too, first one gets only deltas.
+    int second = connectLocal(gameServer.spectatorPort);
+    REQUIRE( send(second, "0\n", 2, 0) == 2 );
+    frames = receiveUntil(second, "Level: ");
+    REQUIRE( frames.find("\x1b[2J") != std::string::npos );
+    frames = receiveUntil(first, "\x1b[");
+    REQUIRE( frames.find("\x1b[2J") == std::string::npos );
+
+    stopServer(gameServer);
+    close(first);
+    close(second);
+}
+
+TEST_CASE( "Server disconnects client sending impossible inputs", "[verify]" ) {
+    ServerOptions options;
+    options.port = 0;
+    options.verifyInputs = true;
+    Server gameServer;
+    REQUIRE( startServer(gameServer, options) );
+
+    int client = connectLocal(gameServer.port);
+    receiveUntil(client, "Level: ");
+    std::string inputs;
+    for (int i = 0; i < 40; i++) {
+        inputs += "0 +w\n";
+    }
+    REQUIRE( send(client, inputs.data(), inputs.size(), 0) ==
+             (ssize_t)inputs.size() );
+    receiveUntil(client, "Too many invalid inputs");
+
+    // Line without end doesn't grow server memory.
+    int endless = connectLocal(gameServer.port);
+    receiveUntil(endless, "Level: ");
+    std::string line(4096, '1');
+    send(endless, line.data(), line.size(), MSG_NOSIGNAL);
+    char buffer[4096];
+    while (recv(endless, buffer, sizeof(buffer), 0) > 0) {
+    }
+
+    stopServer(gameServer);
+    close(client);
+    close(endless);
+}
+
+TEST_CASE( "Restarted server takes over sessions and sockets", "[handoff]" ) {
+    ServerOptions options;
+    options.port = 0;
+    options.simulated = 3;
+    Server oldServer;
+    REQUIRE( startServer(oldServer, options) );
+    int client = connectLocal(oldServer.port);
+    receiveUntil(client, "Level: ");
+
+    int channel[2];
+    REQUIRE( socketpair(AF_UNIX, SOCK_STREAM, 0, channel) == 0 );
+    bool isHanded = false;
+    std::thread handing([&]() { isHanded = handOffServer(oldServer, channel[0]); });
+    Server newServer;
+    REQUIRE( takeOverServer(newServer, options, channel[1]) );
+    handing.join();
+    REQUIRE( isHanded );
+    REQUIRE( newServer.port == oldServer.port );
+    REQUIRE( newServer.nextGameId == 4 );
+    REQUIRE( serverSessions(newServer) == 1 );
+
+    // Old client keeps its game, new ones connect to the same port.
+    int late = connectLocal(newServer.port);
+    receiveUntil(late, "Level: ");
+    REQUIRE( send(client, "Q", 1, 0) == 1 );
+    char buffer[4096];
+    while (recv(client, buffer, sizeof(buffer), 0) > 0) {
+    }
+    while (serverSessions(newServer) != 1) {
+        usleep(1000);
+    }
+
+    stopServer(newServer);
+    close(channel[0]);
+    close(channel[1]);
+    close(client);
+    close(late);
+}
+
+TEST_CASE( "Failed handoff keeps games running", "[handoff]" ) {
+    ServerOptions options;
+    options.port = 0;
+    Server gameServer;
+    REQUIRE( startServer(gameServer, options) );
+    int client = connectLocal(gameServer.port);
+    receiveUntil(client, "Level: ");
+
+    // Peer which isn't a server, then one which never confirms.
+    int channel[2];
+    REQUIRE( socketpair(AF_UNIX, SOCK_STREAM, 0, channel) == 0 );
+    REQUIRE( send(channel[1], "GET ", 4, 0) == 4 );
+    REQUIRE( !handOffServer(gameServer, channel[0]) );
+    close(channel[0]);
+    close(channel[1]);
+
+    REQUIRE( socketpair(AF_UNIX, SOCK_STREAM, 0, channel) == 0 );
+    uint32_t request = 0x54455452;
+    REQUIRE( send(channel[1], &request, sizeof(request), 0) == sizeof(request) );
+    shutdown(channel[1], SHUT_WR);
+    REQUIRE( !handOffServer(gameServer, channel[0]) );
+    close(channel[0]);
+    close(channel[1]);
+
+    // Session still plays and new clients connect.
+    REQUIRE( serverSessions(gameServer) == 1 );
+    char buffer[4096];
+    while (recv(client, buffer, sizeof(buffer), MSG_DONTWAIT) > 0) {
+    }
+    REQUIRE( send(client, " ", 1, 0) == 1 );
+    REQUIRE( recv(client, buffer, sizeof(buffer), 0) > 0 );
+    int late = connectLocal(gameServer.port);
+    receiveUntil(late, "Level: ");
+
+    stopServer(gameServer);
+    close(client);
+    close(late);
+}
+#endif